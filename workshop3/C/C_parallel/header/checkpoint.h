@@ -0,0 +1,28 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "globals.h"
+#include "structs.h"
+#include "utilities.h"
+
+/* Start saving u, v and p of the given iteration, and the flow parameters,
+ * to the older of <s->data>/checkpoint.0 and <s->data>/checkpoint.1. The
+ * fields are copied and written in the background; the previous checkpoint
+ * is completed first. */
+void checkpoint(struct FieldPointers *f, struct Grid2D *g,
+                struct SimulationInfo *s, int itr, int rank);
+
+/* Complete the checkpoint being written, if any */
+void checkpoint_wait(struct Grid2D *g, struct SimulationInfo *s, int rank);
+
+/* Load u, v, p and the flow parameters from the latest complete checkpoint;
+ * returns the iteration to resume from */
+int read_checkpoint(struct FieldPointers *f, struct Grid2D *g,
+            struct SimulationInfo *s, int rank);
+
+#endif /* CHECKPOINT_H */
@@ -0,0 +1,41 @@
+#ifndef COARSE_H
+#define COARSE_H
+
+#include <limits.h>
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "device.h"
+#include "globals.h"
+#include "structs.h"
+#include "utilities.h"
+
+/* Fields at the grid points of a whole grid, written to a file by an earlier
+ * run: u, v and p one after another, each an nx x ny array of doubles in row
+ * major order as in uvp.bin, byte swapped if swap. The same on all the
+ * processes; none if file is empty */
+struct Coarse {
+  int nx;
+  int ny;
+  double dx;
+  double dy;
+  int swap;
+  char file[4096];
+};
+
+/* Read the descriptor desc of the fields written to uvp.bin by an earlier
+ * run on MASTER; all the processes must call it */
+void read_coarse(struct Coarse *c, const char *desc, int rank);
+
+/* Interpolate the fields of a coarser grid, bilinearly, on to the staggered
+ * points of u, v and p, ghost layers included, as the fields to start from.
+ * Each process reads only the block of the fields its points lie in; all
+ * the processes of s->comm must call it. */
+void prolong(const struct Coarse *c, struct FieldPointers *f,
+             struct Grid2D *g, struct SimulationInfo *s, int rank);
+
+#endif /* COARSE_H */
@@ -0,0 +1,29 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "globals.h"
+#include "structs.h"
+
+/* Set the grid size and the case parameters from the command line on MASTER
+ * and broadcast them:
+ * lidCavity [--nx N] [--ny N] [--Re Re] [--tol tol] [--itr-max N]
+ *           [--cfl cfl] [--c2 c2] [--check-itr N] [--checkpoint N]
+ *           [--restart] [--log-itr N] [--log-binary] [--adapt N]
+ *           [--sample N] [--probe x=X | y=Y]... [--ghia dir]
+ *           [--ensemble Re,Re,...] [--sequence n,n,...]
+ *           [--coarse-tol tol] [--init uvp.json] [--weight w]
+ *           [Re [check_itr]]
+ * c2 and cfl left out are set according to Re by initialize. All the
+ * processes terminate on --help or invalid arguments. Each process reads its
+ * own weight. */
+void read_config(int argc, char *argv[], struct Grid2D *g,
+                 struct SimulationInfo *s, int rank);
+
+#endif /* CONFIG_H */
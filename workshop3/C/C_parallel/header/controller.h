@@ -0,0 +1,57 @@
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "globals.h"
+#include "simulationControls.h"
+#include "structs.h"
+#include "utilities.h"
+
+/* Controller of the time step, adjusted every s->adapt_itr iterations: the
+ * CFL number is raised after a window of iterations over which the residuals
+ * went down, and cut, going back to the end of the last good window, once
+ * they blow up. It is not raised again up to the one that failed. */
+struct Controller {
+  /* Copy of u, v and p, ghost layers included, at the end of the last good
+   * window, and its iteration */
+  real *save;
+  int itr;
+
+  /* Largest residual of u, v and p over the first and the second half of
+   * the current window */
+  double first;
+  double second;
+
+  /* CFL number and time step the run started with, and the lowest CFL
+   * number that failed */
+  double cfl0;
+  double dt0;
+  double ceiling;
+
+  /* Number of windows in a row projected to end after s->itr_max */
+  int late;
+};
+
+/* Start controlling from the current fields, which iteration itr starts
+ * from */
+void adapt_init(struct Controller *c, struct FieldPointers *f,
+                struct Grid2D *g, struct SimulationInfo *s, int itr);
+
+/* Rescale the residuals to the time step the run started with */
+void adapt_residuals(struct Controller *c, struct SimulationInfo *s);
+
+/* Look at the residuals of iteration itr, computed by l2_norm, before the
+ * fields are updated; returns the iteration to carry on from. The residuals
+ * are left NaN if the time step cannot be cut any further. */
+int adapt(struct Controller *c, struct FieldPointers *f, struct Grid2D *g,
+          struct SimulationInfo *s, int itr, int rank);
+
+/* Free the copy of the fields */
+void adapt_free(struct Controller *c, struct Grid2D *g);
+
+#endif /* CONTROLLER_H */
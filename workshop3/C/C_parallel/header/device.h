@@ -0,0 +1,33 @@
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "globals.h"
+#include "structs.h"
+#include "timers.h"
+#include "utilities.h"
+
+#ifdef OFFLOAD
+#include <omp.h>
+
+/* Select a device for the process among the ones of its node and map the
+ * fields onto it; they stay resident there for the whole run, and update
+ * only swaps which of them are current */
+void device_init(struct Grid2D *g, struct SimulationInfo *s, int rank);
+
+/* Copy u, v and p, ghost layers included, from the device to the host */
+void device_get(struct FieldPointers *f, struct Grid2D *g);
+
+/* Copy u, v and p, ghost layers included, from the host to the device */
+void device_put(struct FieldPointers *f, struct Grid2D *g);
+
+/* Exchange the ghost layers of a field resident on the device with the
+ * neighbor partitions */
+void exchange_halo_device(real *arr, struct Grid2D *g,
+                          struct SimulationInfo *s);
+#endif /* OFFLOAD */
+
+#endif /* DEVICE_H */
@@ -0,0 +1,33 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "globals.h"
+#include "member.h"
+#include "structs.h"
+#include "timers.h"
+
+/* Iterations a member is advanced by before the members are scheduled
+ * again */
+#define ENSEMBLE_BATCH 100
+
+/* Whether the command line asks for an ensemble, which needs
+ * MPI_THREAD_MULTIPLE to advance its members on several threads at once */
+int ensemble_requested(int argc, char *argv[]);
+
+/* Solve the cases of Re = s->members[k], on the grid g and with the other
+ * settings of s, together, each writing to data/Re<Re>. The members are
+ * spread over the OpenMP threads, their kernels sharing the threads left
+ * over, and converged members retire, handing their threads over to the
+ * others. Returns the exit status: failure if any member did not converge. */
+int run_ensemble(struct Grid2D *g, struct SimulationInfo *s, int rank,
+                 int nprocs, int provided);
+
+#endif /* ENSEMBLE_H */
@@ -1,14 +1,47 @@
 #ifndef GLOBALS_H
 #define GLOBALS_H
 
-/* Specify number of grid points in x and y directions */
+/* Default number of grid points in x and y directions */
 #define IX 128
 #define IY 128
 
+/* Fields are aligned to, and their rows padded to a multiple of, a cache line
+ * (in bytes) */
+#define ALIGN 64
+
+/* Most lines the fields are sampled along, the centrelines included */
+#define SAMPLE_LINES 8
+
+/* Most members of an ensemble */
+#define ENSEMBLE_MEMBERS 64
+
+/* Most grids of a sequence */
+#define SEQUENCE_LEVELS 16
+
+/* Index of the point (i, j) of a field; the row stride of the fields must be
+ * in scope as st */
+#define IDX(i, j) ((i) * st + (j))
+
+/* Type of the values stored in the fields, and its MPI datatype; the
+ * kernels compute in double and the residuals are summed up in double
+ * whatever it is */
+#ifdef FLOAT
+typedef float real;
+#define REAL_MPI MPI_FLOAT
+#else
+typedef double real;
+#define REAL_MPI MPI_DOUBLE
+#endif
+
 /* MPI variables */
 #define MASTER (rank == 0)
 #define NODE (rank != 0)
-#define LAST_NODE (rank == nprocs - 1)
 #define WORLD MPI_COMM_WORLD
 
+/* Physical boundaries owned by a process */
+#define TOP_WALL (s->nbr[0] == MPI_PROC_NULL)
+#define LEFT_WALL (s->nbr[1] == MPI_PROC_NULL)
+#define BOTTOM_WALL (s->nbr[2] == MPI_PROC_NULL)
+#define RIGHT_WALL (s->nbr[3] == MPI_PROC_NULL)
+
 #endif /* GLOBALS_H */
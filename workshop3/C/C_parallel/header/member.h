@@ -0,0 +1,50 @@
+#ifndef MEMBER_H
+#define MEMBER_H
+
+#include <errno.h>
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "coarse.h"
+#include "controller.h"
+#include "globals.h"
+#include "residualLog.h"
+#include "sampler.h"
+#include "simulationControls.h"
+#include "structs.h"
+#include "writer.h"
+
+/* States of a case after advancing it */
+enum { RUNNING, CONVERGED, DIVERGED, EXCEEDED };
+
+/* A case solved apart from the one of lidCavity, e.g. a member of an
+ * ensemble or a coarse grid of a sequence, with all of its own state */
+struct Member {
+  struct Grid2D g;
+  struct FieldPointers f;
+  struct SimulationInfo s;
+  struct ResidualLog log;
+  struct Controller ctl;
+  struct Sampler smp;
+  int itr;
+};
+
+/* Set up a case with the grid g and the settings of s, writing to s->data,
+ * which MASTER creates; it starts from the fields of a coarser grid c, or
+ * from the lid alone if c is NULL */
+void member_start(struct Member *m, struct Grid2D *g,
+                  struct SimulationInfo *s, const struct Coarse *c, int rank,
+                  int nprocs);
+
+/* Advance a case by up to n iterations, as the time loop of lidCavity does;
+ * returns its state */
+int member_advance(struct Member *m, int n, int rank);
+
+/* Retire a case: write its fields out if it converged and free all of its
+ * memory */
+void member_finish(struct Member *m, int state, int rank, int nprocs);
+
+#endif /* MEMBER_H */
@@ -0,0 +1,33 @@
+#ifndef RESIDUALLOG_H
+#define RESIDUALLOG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Number of records kept in memory before they are written out */
+#define LOG_RECORDS 1024
+
+/* Residual log: the records {iteration, total, u, v, p, divergence} are
+ * buffered and written in blocks, either as text to <dir>/residual or as raw
+ * doubles, six per record, to <dir>/residual.bin */
+struct ResidualLog {
+  FILE *fd;
+  int binary;
+  int count;
+  double records[LOG_RECORDS][6];
+};
+
+/* Open the log file in the directory dir; append to it when resuming a run */
+void log_open(struct ResidualLog *log, const char *dir, int binary,
+              int append);
+
+/* Add the residuals of an iteration to the log */
+void log_residuals(struct ResidualLog *log, int itr, double *errs);
+
+/* Write out the buffered records */
+void log_flush(struct ResidualLog *log);
+
+/* Write out the buffered records and close the log file */
+void log_close(struct ResidualLog *log);
+
+#endif /* RESIDUALLOG_H */
@@ -0,0 +1,52 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "globals.h"
+#include "simulationControls.h"
+#include "structs.h"
+#include "utilities.h"
+
+/* Most points of a table of Ghia et al. */
+#define GHIA_POINTS 64
+
+/* Sampler of u, v and p along the lines of s->line_dir and s->line_pos,
+ * interpolated linearly between the grid points next to them. Each process
+ * only adds up the points it owns, so that just the lines are summed up on
+ * MASTER, which writes them to <s->data>/sample.<iteration>. */
+struct Sampler {
+  /* Offset of the values of each line, u, v and p one after another, and
+   * their total number */
+  int offset[SAMPLE_LINES];
+  int len;
+
+  /* Values of the lines of the process, and their sum on MASTER */
+  double *local;
+  double *global;
+
+  /* Tables of Ghia et al. at Re on MASTER: u along x = 0.5 and v along
+   * y = 0.5, and the log of the scores, none if fd is NULL */
+  int npts[2];
+  double pos[2][GHIA_POINTS];
+  double val[2][GHIA_POINTS];
+  FILE *fd;
+};
+
+/* Set up the sampling of the lines, and read the tables of Ghia et al. from
+ * s->ghia on MASTER */
+void sample_init(struct Sampler *sp, struct Grid2D *g,
+                 struct SimulationInfo *s, int rank);
+
+/* Sample the lines after iteration itr, and score the centrelines against
+ * the tables of Ghia et al.; all the processes must call it */
+void sample(struct Sampler *sp, struct FieldPointers *f, struct Grid2D *g,
+            struct SimulationInfo *s, int itr, int rank);
+
+/* Free the lines and close the log of the scores */
+void sample_free(struct Sampler *sp);
+
+#endif /* SAMPLER_H */
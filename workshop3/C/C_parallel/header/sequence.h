@@ -0,0 +1,21 @@
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "coarse.h"
+#include "globals.h"
+#include "member.h"
+#include "structs.h"
+
+/* Solve the coarse grids of a sequence, s->levels but the last one, one
+ * after another to s->coarse_tol, each one from the fields of the one before,
+ * or of c for the first one unless they are none, and writing to
+ * data/N<nx>; c is left with the fields of the last one. All the processes
+ * terminate if one of them does not converge. */
+void run_sequence(struct Coarse *c, struct Grid2D *g, struct SimulationInfo *s,
+                  int rank, int nprocs);
+
+#endif /* SEQUENCE_H */
@@ -0,0 +1,54 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <math.h>
+
+#include "globals.h"
+#include "structs.h"
+
+#ifdef SIMD
+#include <immintrin.h>
+
+/* Vector type and operations of the widest instruction set enabled at build
+ * time, e.g. by -march=native */
+#if defined(__AVX512F__)
+#define VLEN 8
+typedef __m512d vec;
+#define vload(a) _mm512_loadu_pd(a)
+#define vstore(a, x) _mm512_storeu_pd(a, x)
+#define vset1(x) _mm512_set1_pd(x)
+#define vadd(x, y) _mm512_add_pd(x, y)
+#define vsub(x, y) _mm512_sub_pd(x, y)
+#define vmul(x, y) _mm512_mul_pd(x, y)
+#define vzero() _mm512_setzero_pd()
+#elif defined(__AVX2__)
+#define VLEN 4
+typedef __m256d vec;
+#define vload(a) _mm256_loadu_pd(a)
+#define vstore(a, x) _mm256_storeu_pd(a, x)
+#define vset1(x) _mm256_set1_pd(x)
+#define vadd(x, y) _mm256_add_pd(x, y)
+#define vsub(x, y) _mm256_sub_pd(x, y)
+#define vmul(x, y) _mm256_mul_pd(x, y)
+#define vzero() _mm256_setzero_pd()
+#else
+#error "SIMD kernels need AVX2 or AVX-512, e.g. compile with -march=native"
+#endif
+
+/* Update u and v on the given ranges of their interior points */
+void momentum_simd(struct FieldPointers *f, struct Grid2D *g,
+                   struct SimulationInfo *s, struct Range *ru,
+                   struct Range *rv);
+
+/* Update p on the given range of its interior points */
+void continuity_simd(struct FieldPointers *f, struct Grid2D *g,
+                     struct SimulationInfo *s, struct Range *r);
+
+/* Sum up the squared changes of u, v and p and the squared divergence on the
+ * given range; errs = {u err, v err, p err, div U} */
+void residuals_simd(struct FieldPointers *f, struct Grid2D *g,
+                    struct SimulationInfo *s, struct Range *r, double *errs);
+
+#endif /* SIMD */
+
+#endif /* SIMD_H */
@@ -5,22 +5,45 @@
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
+#include "device.h"
 #include "globals.h"
+#include "simd.h"
 #include "structs.h"
+#include "timers.h"
 #include "utilities.h"
 
 /* Applying boundary conditions for velocity */
 void initialize(struct FieldPointers *f, struct Grid2D *g,
                 struct SimulationInfo *s, int rank, int nprocs);
 
+/* Set the time step according to the CFL number */
+void set_dt(struct Grid2D *g, struct SimulationInfo *s);
+
 /* Set initial condition */
 void set_init(struct FieldPointers *f, struct Grid2D *g,
               struct SimulationInfo *s);
 
+/* Exchange the ghost layers of a field with the neighbor partitions */
+void exchange_halo(real *arr, struct Grid2D *g, struct SimulationInfo *s);
+
+/* Start exchanging the ghost layers of a field without blocking */
+void halo_start(real *arr, struct Grid2D *g, struct SimulationInfo *s,
+                MPI_Request *req);
+
+/* Complete a halo exchange started by halo_start */
+void halo_wait(MPI_Request *req);
+
 /* Applying boundary conditions for velocity */
-void set_BC(struct FieldPointers *f, struct Grid2D *g, struct SimulationInfo *s,
-            int rank, int nprocs);
+void set_UBC(struct FieldPointers *f, struct Grid2D *g,
+             struct SimulationInfo *s);
+
+/* Applying boundary conditions for pressure */
+void set_PBC(struct FieldPointers *f, struct Grid2D *g,
+             struct SimulationInfo *s);
 
 /* Update the fields to the new time step for the next iteration */
 void update(struct FieldPointers *f);
@@ -33,8 +56,8 @@ void solve_U(struct FieldPointers *f, struct Grid2D *g,
 void solve_P(struct FieldPointers *f, struct Grid2D *g,
              struct SimulationInfo *s);
 
-/* Compute L2-norm */
-void l2_norm(struct FieldPointers *f, struct Grid2D *g, struct SimulationInfo *s,
-             int rank, int nprocs);
+/* Compute L2-norm; the divergence residual is the norm of the divergence */
+void l2_norm(struct FieldPointers *f, struct Grid2D *g,
+             struct SimulationInfo *s);
 
 #endif /* SIMULATIONCONTROLS_H */
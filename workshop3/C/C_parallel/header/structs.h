@@ -1,15 +1,28 @@
 #ifndef STRUCTS_H
 #define STRUCTS_H
 
+#include <mpi.h>
+
+#include "globals.h"
+
+/* Local index bounds, [is, ie) x [js, je), of the points updated by a loop */
+struct Range {
+  int is;
+  int ie;
+  int js;
+  int je;
+};
+
 struct Grid2D {
   /* Two arrays are required for each Variable; one for old time step and one
-   * for the new time step. */
-  double **ubufo;
-  double **ubufn;
-  double **vbufo;
-  double **vbufn;
-  double **pbufo;
-  double **pbufn;
+   * for the new time step. Each one is a single aligned block, stored row by
+   * row with the row stride below. */
+  real *ubufo;
+  real *ubufn;
+  real *vbufo;
+  real *vbufn;
+  real *pbufo;
+  real *pbufn;
 
   /* Number of grid points */
   int nx;
@@ -19,22 +32,39 @@ struct Grid2D {
   double dx;
   double dy;
 
-  /* Number of rows in a process */
+  /* Global index of the first row and column owned by a process */
+  int x0;
+  int y0;
+  /* Number of rows and columns owned by a process; all the local arrays have
+   * one extra ghost layer on each side, i.e. (nx_p + 2) x (ny_p + 2). */
   int nx_p;
-  /* Number of staggered rows in a process */
-  int nx_psg;
-  /* Number of ghost rows in a process */
-  int ghosts;
+  int ny_p;
+
+  /* Local bounds of the interior points of u, v and p and of the points
+   * contributing to the residuals */
+  struct Range ur;
+  struct Range vr;
+  struct Range pr;
+  struct Range er;
+
+  /* Distance between two consecutive rows of a field */
+  int stride;
+
+  /* Datatype for exchanging a column (fixed j) of the owned rows */
+  MPI_Datatype col;
+
+  /* Packed columns of the top and bottom halo exchanges */
+  real *hbuf;
 } g;
 
 struct FieldPointers {
   /* Pointers to the generated buffer arrays for each variable */
-  double **u;
-  double **un;
-  double **v;
-  double **vn;
-  double **p;
-  double **pn;
+  real *u;
+  real *un;
+  real *v;
+  real *vn;
+  real *p;
+  real *pn;
 } f;
 
 struct SimulationInfo {
@@ -61,10 +91,83 @@ struct SimulationInfo {
 
   /* Errors: {total, u err, v err, p err, div U} */
   double errs[5];
+  /* Number of iterations between two residual checks */
+  int check_itr;
+
+  /* Convergence tolerance and maximum number of iterations */
+  double tol;
+  int itr_max;
+
+  /* Number of iterations between two logged residuals and whether they are
+   * logged in binary */
+  int log_itr;
+  int log_binary;
+
+  /* Number of iterations between two adjustments of the time step, none if
+   * 0 */
+  int adapt_itr;
+
+  /* Lines the fields are sampled along, the centrelines first, none if
+   * nlines is 0: x = line_pos if line_dir is 0, y = line_pos if it is 1.
+   * They are sampled every sample_itr iterations, if not 0, and once
+   * converged; the centrelines are scored against the tables of Ghia et al.
+   * in the directory ghia, unless NULL, on MASTER. */
+  int nlines;
+  int line_dir[SAMPLE_LINES];
+  double line_pos[SAMPLE_LINES];
+  int sample_itr;
+  const char *ghia;
+
+  /* Directory the output files are written to */
+  char data[64];
+
+  /* Reynolds numbers of the members of an ensemble advanced together, none
+   * if nmembers is 0 */
+  int nmembers;
+  double members[ENSEMBLE_MEMBERS];
+
+  /* Grid sizes of a sequence, none if nlevels is 0: the coarse ones are
+   * solved to coarse_tol first, each one starting from the one before, and
+   * the last one is the grid solved. With warm the first one starts from the
+   * fields written to uvp.bin by an earlier run, described by init on
+   * MASTER. */
+  int nlevels;
+  int levels[SEQUENCE_LEVELS];
+  double coarse_tol;
+  int warm;
+  const char *init;
+
+  /* Relative speed of the process, which its share of the grid is
+   * proportional to */
+  double weight;
+
+  /* Cartesian communicator, its dimensions and coordinates of the process */
+  MPI_Comm comm;
+  int dims[2];
+  int coords[2];
+
+  /*  Neighbor partitions: {top, left, bottom, right}, MPI_PROC_NULL on the
+   *  physical boundaries */
+  int nbr[4];
+  /* Corner partitions: {top-left, bottom-left, bottom-right, top-right} */
+  int cnbr[4];
+
+  /* Pending non-blocking halo exchanges of u, v and p; the requests for
+   * receiving and sending the 4 sides and the 4 corners */
+  MPI_Request ureq[16];
+  MPI_Request vreq[16];
+  MPI_Request preq[16];
 
-  /*  Neighbor partitions */
-  int prev;
-  int next;
+  /* Number of iterations between two checkpoints, none if 0, and whether to
+   * resume from the latest one */
+  int ckpt_itr;
+  int restart;
+  /* Checkpoint being written: its file, a copy of u, v and p and the
+   * requests for writing them */
+  MPI_File ckpt_fh;
+  int ckpt_itr_saved;
+  real *ckpt_buf;
+  MPI_Request ckpt_req[3];
 } s;
 
 #endif /* STRUCTS_H */
@@ -0,0 +1,50 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+/* Shared by C_parallel and C_parallel3D, so it depends on neither of their
+ * headers */
+
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Phases of an iteration timed with TIMERS; a phase started within another
+ * one pauses it, so each time is exclusive */
+enum Phase {
+  T_MOMENTUM,
+  T_CONTINUITY,
+  T_BOUNDARY,
+  T_HALO,
+  T_RESIDUAL,
+  T_ALLREDUCE,
+  T_OUTPUT,
+  T_PHASES
+};
+
+#ifdef TIMERS
+#define TIMER_INIT() timer_init()
+#define TIMER_START(k) timer_start(k)
+#define TIMER_STOP() timer_stop()
+#define TIMER_REPORT(rank, nprocs) timer_report(rank, nprocs)
+
+/* Start the clock of the whole run, and the hardware counters with PAPI */
+void timer_init(void);
+
+/* Enter a phase */
+void timer_start(enum Phase k);
+
+/* Leave the phase entered last */
+void timer_stop(void);
+
+/* Print the time per phase of each process and their min/avg/max on
+ * MASTER; all the processes must call it */
+void timer_report(int rank, int nprocs);
+#else
+#define TIMER_INIT()
+#define TIMER_START(k)
+#define TIMER_STOP()
+#define TIMER_REPORT(rank, nprocs)
+#endif /* TIMERS */
+
+#endif /* TIMERS_H */
@@ -6,11 +6,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "globals.h"
 #include "structs.h"
 
 /* Generate a 2D array using pointer to pointer */
 double **array_2D(int row, int col);
 
+/* Find the row stride of a field with col columns */
+int field_stride(int col);
+
+/* Generate a zeroed 2D field stored row by row in one aligned block */
+real *field_2D(int row, int stride);
+
+/* Free the buffers of all the fields */
+void free_fields(struct Grid2D *g);
+
 /* Update the fields to the new time step for the next iteration */
 void update(struct FieldPointers *f);
 
@@ -20,4 +30,12 @@ void freeMem(int count, ...);
 /* Find mamximum of a set of float numebrs */
 double fmaxof(int count, ...);
 
+/* Split n points into nparts blocks with sizes proportional to the weights
+ * w; block k spans [start[k], start[k + 1]) */
+void partition(int n, int nparts, const double *w, int *start);
+
+/* Find the local bounds of the global interval [lo, hi) on a block that
+ * starts at the global index start and has size points */
+void local_range(int lo, int hi, int start, int size, int *ls, int *le);
+
 #endif /* UTILITITES_H */
@@ -9,7 +9,9 @@
 #include "structs.h"
 #include "utilities.h"
 
-/* Save fields data to files */
-void dump_data(struct Grid2D *g, struct FieldPointers *f, int rank, int nprocs);
+/* Save fields data to <s->data>/uvp.bin, described by <s->data>/uvp.json,
+ * and free the fields and the communicator */
+void dump_data(struct Grid2D *g, struct FieldPointers *f,
+               struct SimulationInfo *s, int rank, int nprocs);
 
 #endif /* WRITER_H */
@@ -0,0 +1,212 @@
+#include "checkpoint.h"
+
+/* Bytes reserved for the header at the start of a checkpoint file */
+#define HEADER_SIZE 4096
+
+/* Header of a checkpoint file; the blocks of u, v and p of all the processes
+ * follow it in the order of their ranks. Each block covers the whole local
+ * arrays, ghost layers included, so a run can only be resumed on the same
+ * grid and process grid, and with the same precision of the fields. */
+struct Header {
+  /* Iteration of the saved fields; 0 until all of them are written */
+  int itr;
+
+  int nprocs;
+  int nx;
+  int ny;
+  int dims[2];
+  /* Bytes per value of the fields */
+  int real_size;
+
+  /* Flow parameters */
+  double Re;
+  double nu;
+  double c2;
+  double cfl;
+  double dt;
+  double dtdx;
+  double dtdy;
+  double dtdxx;
+  double dtdyy;
+  double dtdxdy;
+};
+
+/* Fill the header of a checkpoint of the given iteration */
+static void set_header(struct Header *h, struct Grid2D *g,
+                       struct SimulationInfo *s, int itr) {
+  *h = ((struct Header){.itr = itr,
+                        .nx = g->nx,
+                        .ny = g->ny,
+                        .dims = {s->dims[0], s->dims[1]},
+                        .real_size = sizeof(real),
+                        .Re = s->Re,
+                        .nu = s->nu,
+                        .c2 = s->c2,
+                        .cfl = s->cfl,
+                        .dt = s->dt,
+                        .dtdx = s->dtdx,
+                        .dtdy = s->dtdy,
+                        .dtdxx = s->dtdxx,
+                        .dtdyy = s->dtdyy,
+                        .dtdxdy = s->dtdxdy});
+  MPI_Comm_size(s->comm, &h->nprocs);
+}
+
+/* Find the offset of the block of the process in a checkpoint file and the
+ * number of values of each of its fields */
+static MPI_Offset block_offset(struct Grid2D *g, struct SimulationInfo *s,
+                               int rank, int *n) {
+  long long bytes, offset = 0;
+
+  *n = (g->nx_p + 2) * g->stride;
+  bytes = 3LL * *n * sizeof(real);
+  MPI_Exscan(&bytes, &offset, 1, MPI_LONG_LONG, MPI_SUM, s->comm);
+  if (MASTER) {
+    offset = 0;
+  }
+  return (MPI_Offset)(HEADER_SIZE + offset);
+}
+
+/* Start saving u, v and p of the given iteration and the flow parameters */
+void checkpoint(struct FieldPointers *f, struct Grid2D *g,
+                struct SimulationInfo *s, int itr, int rank) {
+  int k, n;
+  char name[128];
+  real *fields[3] = {f->u, f->v, f->p};
+  MPI_Offset offset;
+
+  /* Only one checkpoint is written at a time */
+  checkpoint_wait(g, s, rank);
+
+  snprintf(name, sizeof(name), "%s/checkpoint.%d", s->data,
+           (itr / s->ckpt_itr) % 2);
+  MPI_File_open(s->comm, name, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                MPI_INFO_NULL, &s->ckpt_fh);
+
+  /* The checkpoint previously in this file is no longer valid */
+  if (MASTER) {
+    struct Header h;
+
+    set_header(&h, g, s, 0);
+    MPI_File_write_at(s->ckpt_fh, 0, &h, sizeof(h), MPI_BYTE,
+                      MPI_STATUS_IGNORE);
+  }
+
+  /* The fields change while they are written, so a copy is written */
+  offset = block_offset(g, s, rank, &n);
+  s->ckpt_buf = (real *)aligned_alloc(ALIGN, 3 * sizeof(real) * n);
+  if (!s->ckpt_buf) {
+    printf("Memory allocation error.\n");
+    MPI_Abort(s->comm, EXIT_FAILURE);
+  }
+  for (k = 0; k < 3; k++) {
+    memcpy(s->ckpt_buf + k * n, fields[k], sizeof(real) * n);
+    MPI_File_iwrite_at(s->ckpt_fh, offset + (MPI_Offset)k * n * sizeof(real),
+                       s->ckpt_buf + k * n, n, REAL_MPI, &s->ckpt_req[k]);
+  }
+  s->ckpt_itr_saved = itr;
+}
+
+/* Complete the checkpoint being written, if any */
+void checkpoint_wait(struct Grid2D *g, struct SimulationInfo *s, int rank) {
+  if (s->ckpt_itr_saved == 0) {
+    return;
+  }
+
+  MPI_Waitall(3, s->ckpt_req, MPI_STATUSES_IGNORE);
+  free(s->ckpt_buf);
+  s->ckpt_buf = NULL;
+
+  /* Mark the checkpoint as valid once all the blocks are on disk */
+  MPI_File_sync(s->ckpt_fh);
+  if (MASTER) {
+    struct Header h;
+
+    set_header(&h, g, s, s->ckpt_itr_saved);
+    MPI_File_write_at(s->ckpt_fh, 0, &h, sizeof(h), MPI_BYTE,
+                      MPI_STATUS_IGNORE);
+  }
+  MPI_File_close(&s->ckpt_fh);
+  s->ckpt_itr_saved = 0;
+}
+
+/* Load u, v, p and the flow parameters from the latest complete checkpoint */
+int read_checkpoint(struct FieldPointers *f, struct Grid2D *g,
+            struct SimulationInfo *s, int rank) {
+  int k, n, slot = -1, nprocs;
+  char name[128];
+  real *fields[3] = {f->u, f->v, f->p};
+  struct Header h;
+  MPI_File fh;
+  MPI_Offset offset;
+
+  if (MASTER) {
+    int latest = 0;
+
+    for (k = 0; k < 2; k++) {
+      FILE *fd;
+
+      snprintf(name, sizeof(name), "%s/checkpoint.%d", s->data, k);
+      fd = fopen(name, "rb");
+      if (fd) {
+        if (fread(&h, sizeof(h), 1, fd) == 1 && h.itr > latest) {
+          latest = h.itr;
+          slot = k;
+        }
+        fclose(fd);
+      }
+    }
+    if (slot < 0) {
+      printf("No complete checkpoint in %s/ to restart from\n", s->data);
+    }
+  }
+  MPI_Bcast(&slot, 1, MPI_INT, 0, s->comm);
+  if (slot < 0) {
+    free_fields(g);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  snprintf(name, sizeof(name), "%s/checkpoint.%d", s->data, slot);
+  MPI_File_open(s->comm, name, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+  MPI_File_read_at_all(fh, 0, &h, sizeof(h), MPI_BYTE, MPI_STATUS_IGNORE);
+
+  MPI_Comm_size(s->comm, &nprocs);
+  if (h.nprocs != nprocs || h.nx != g->nx || h.ny != g->ny ||
+      h.dims[0] != s->dims[0] || h.dims[1] != s->dims[1] ||
+      h.real_size != (int)sizeof(real)) {
+    if (MASTER) {
+      printf("%s is for a %d x %d grid on %d x %d processes with %s fields\n",
+             name, h.nx, h.ny, h.dims[0], h.dims[1],
+             h.real_size == sizeof(float) ? "float" : "double");
+    }
+    MPI_File_close(&fh);
+    free_fields(g);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  offset = block_offset(g, s, rank, &n);
+  for (k = 0; k < 3; k++) {
+    MPI_File_read_at_all(fh, offset + (MPI_Offset)k * n * sizeof(real),
+                         fields[k], n, REAL_MPI, MPI_STATUS_IGNORE);
+  }
+  MPI_File_close(&fh);
+
+  s->Re = h.Re;
+  s->nu = h.nu;
+  s->c2 = h.c2;
+  s->cfl = h.cfl;
+  s->dt = h.dt;
+  s->dtdx = h.dtdx;
+  s->dtdy = h.dtdy;
+  s->dtdxx = h.dtdxx;
+  s->dtdyy = h.dtdyy;
+  s->dtdxdy = h.dtdxdy;
+
+  if (MASTER) {
+    printf("Restarting from iteration %d of %s, Re = %d\n", h.itr, name,
+           (int)s->Re);
+  }
+  return h.itr + 1;
+}
@@ -0,0 +1,182 @@
+#include "coarse.h"
+
+/* Read the descriptor desc of the fields written to uvp.bin by an earlier
+ * run on MASTER; all the processes must call it */
+void read_coarse(struct Coarse *c, const char *desc, int rank) {
+  int shape[2] = {0, 0};
+  double spacing[2] = {0.0, 0.0};
+
+  c->swap = 0;
+  c->file[0] = '\0';
+  if (MASTER) {
+    char text[4096], file[256] = "", order[16] = "", *key, end = '\0';
+    const char *slash = strrchr(desc, '/');
+    const int one = 1;
+    size_t len = 0;
+    struct stat st;
+    FILE *fd = fopen(desc, "rte");
+    int ok;
+
+    if (fd) {
+      len = fread(text, 1, sizeof(text) - 1, fd);
+      fclose(fd);
+    }
+    text[len] = '\0';
+
+    /* The descriptor written by dump_data: doubles on a 2D grid, in the byte
+     * order given, the native one if none */
+    ok = (key = strstr(text, "\"shape\"")) && (key = strchr(key, '[')) &&
+         sscanf(key, "[%d ,%d %c", &shape[0], &shape[1], &end) == 3 &&
+         end == ']';
+    ok = ok && (key = strstr(text, "\"spacing\"")) &&
+         (key = strchr(key, '[')) &&
+         sscanf(key, "[%lf ,%lf %c", &spacing[0], &spacing[1], &end) == 3 &&
+         end == ']';
+    if ((key = strstr(text, "\"file\"")) && (key = strchr(key + 6, '"'))) {
+      sscanf(key, "\"%255[^\"]\"", file);
+    }
+    if ((key = strstr(text, "\"byte_order\"")) &&
+        (key = strchr(key + 12, '"'))) {
+      sscanf(key, "\"%15[^\"]\"", order);
+    }
+    if (!ok || !file[0] || shape[0] < 2 || shape[1] < 2 ||
+        !(spacing[0] > 0.0) || !(spacing[1] > 0.0) ||
+        !strstr(text, "\"float64\"") ||
+        (order[0] && strcmp(order, "little") && strcmp(order, "big"))) {
+      printf("Cannot read the fields described by %s\n", desc);
+      MPI_Abort(WORLD, EXIT_FAILURE);
+    }
+    c->swap = order[0] && strcmp(order, *(const char *)&one ? "little" : "big");
+
+    snprintf(c->file, sizeof(c->file), "%.*s%s",
+             slash ? (int)(slash - desc + 1) : 0, desc, file);
+    if (stat(c->file, &st) != 0 ||
+        (double)st.st_size < 3.0 * sizeof(double) * shape[0] * shape[1]) {
+      printf("Cannot read the fields in %s\n", c->file);
+      MPI_Abort(WORLD, EXIT_FAILURE);
+    }
+  }
+
+  MPI_Bcast(shape, 2, MPI_INT, 0, WORLD);
+  MPI_Bcast(spacing, 2, MPI_DOUBLE, 0, WORLD);
+  MPI_Bcast(&c->swap, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(c->file, sizeof(c->file), MPI_CHAR, 0, WORLD);
+  c->nx = shape[0];
+  c->ny = shape[1];
+  c->dx = spacing[0];
+  c->dy = spacing[1];
+}
+
+/* Position of x on the coarser grid along a direction of n points spaced by
+ * d, the nearest point outside of the domain */
+static double position(double x, double d, int n) {
+  return fmin(fmax(x / d, 0.0), n - 1.0);
+}
+
+/* Lower point of the cell of the coarser grid that position fx lies in */
+static int cell(double fx, int n) {
+  return (int)fx < n - 2 ? (int)fx : n - 2;
+}
+
+/* Value of a field of the coarser grid at (x, y), from its block a of nj
+ * points along y starting at the point (i0, j0) */
+static double bilinear(const double *a, const struct Coarse *c, int i0,
+                       int j0, int nj, double x, double y) {
+  double fx = position(x, c->dx, c->nx), fy = position(y, c->dy, c->ny);
+  int i = cell(fx, c->nx), j = cell(fy, c->ny);
+  double wx = fx - i, wy = fy - j;
+  const double *a0 = a + (size_t)(i - i0) * nj + (j - j0), *a1 = a0 + nj;
+
+  return (1.0 - wx) * ((1.0 - wy) * a0[0] + wy * a0[1]) +
+         wx * ((1.0 - wy) * a1[0] + wy * a1[1]);
+}
+
+/* Reverse the bytes of each of the n doubles of a */
+static void swap_bytes(double *a, size_t n) {
+  for (size_t k = 0; k < n; k++) {
+    unsigned char *b = (unsigned char *)(a + k), t;
+
+    for (int l = 0; l < 4; l++) {
+      t = b[l];
+      b[l] = b[7 - l];
+      b[7 - l] = t;
+    }
+  }
+}
+
+/* Interpolate the fields of a coarser grid, bilinearly, on to the staggered
+ * points of u, v and p, ghost layers included, as the fields to start
+ * from. u(i, j) lies at (x_i, y_j - dy / 2), v(i, j) at (x_i - dx / 2, y_j)
+ * and p(i, j) at (x_i - dx / 2, y_j - dy / 2), x_i and y_j being the grid
+ * point of the global indices of the local (i, j). */
+void prolong(const struct Coarse *c, struct FieldPointers *f,
+             struct Grid2D *g, struct SimulationInfo *s, int rank) {
+  int i, j, k, st = g->stride;
+  int sizes[2] = {c->nx, c->ny}, subsizes[2], starts[2];
+  size_t n;
+  double *uvp;
+  MPI_File fh;
+  MPI_Datatype block;
+  MPI_Offset disp = (MPI_Offset)c->nx * c->ny * sizeof(double);
+
+  /* Block of the points of the cells the local points lie in, from those of
+   * the first v and p to those of the last u and v, computed as in the
+   * loop below */
+  starts[0] = cell(position((-1 + g->x0) * g->dx - 0.5 * g->dx, c->dx, c->nx),
+                   c->nx);
+  starts[1] = cell(position((-1 + g->y0) * g->dy - 0.5 * g->dy, c->dy, c->ny),
+                   c->ny);
+  subsizes[0] =
+      cell(position((g->nx_p + g->x0) * g->dx, c->dx, c->nx), c->nx) + 2 -
+      starts[0];
+  subsizes[1] =
+      cell(position((g->ny_p + g->y0) * g->dy, c->dy, c->ny), c->ny) + 2 -
+      starts[1];
+  if ((double)subsizes[0] * subsizes[1] > INT_MAX) {
+    if (MASTER) {
+      printf("The block of the fields in %s is too large\n", c->file);
+    }
+    MPI_Abort(WORLD, EXIT_FAILURE);
+  }
+  n = (size_t)subsizes[0] * subsizes[1];
+  uvp = (double *)malloc(sizeof(double) * 3 * n);
+
+  MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+                           MPI_DOUBLE, &block);
+  MPI_Type_commit(&block);
+  if (MPI_File_open(s->comm, c->file, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) !=
+      MPI_SUCCESS) {
+    if (MASTER) {
+      printf("Cannot read the fields in %s\n", c->file);
+    }
+    MPI_Abort(WORLD, EXIT_FAILURE);
+  }
+  for (k = 0; k < 3; k++) {
+    MPI_File_set_view(fh, k * disp, MPI_DOUBLE, block, "native",
+                      MPI_INFO_NULL);
+    MPI_File_read_all(fh, uvp + k * n, (int)n, MPI_DOUBLE, MPI_STATUS_IGNORE);
+  }
+  MPI_File_close(&fh);
+  MPI_Type_free(&block);
+  if (c->swap) {
+    swap_bytes(uvp, 3 * n);
+  }
+
+  for (i = 0; i < g->nx_p + 2; i++) {
+    for (j = 0; j < g->ny_p + 2; j++) {
+      double x = (i - 1 + g->x0) * g->dx, y = (j - 1 + g->y0) * g->dy;
+
+      f->u[IDX(i, j)] = (real)bilinear(uvp, c, starts[0], starts[1],
+                                       subsizes[1], x, y - 0.5 * g->dy);
+      f->v[IDX(i, j)] = (real)bilinear(uvp + n, c, starts[0], starts[1],
+                                       subsizes[1], x - 0.5 * g->dx, y);
+      f->p[IDX(i, j)] =
+          (real)bilinear(uvp + 2 * n, c, starts[0], starts[1], subsizes[1],
+                         x - 0.5 * g->dx, y - 0.5 * g->dy);
+    }
+  }
+  free(uvp);
+#ifdef OFFLOAD
+  device_put(f, g);
+#endif
+}
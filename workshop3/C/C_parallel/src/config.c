@@ -0,0 +1,434 @@
+#include "config.h"
+
+/* Print the usage */
+static void usage(const char *name, FILE *fd) {
+  fprintf(fd,
+          "Usage: %s [OPTION]... [Re [check_itr]]\n"
+          "options:\n"
+          "  --nx <int>         Number of grid points in x (default %d)\n"
+          "  --ny <int>         Number of grid points in y (default %d)\n"
+          "  --Re <float>       Reynolds number (default 100)\n"
+          "  --tol <float>      Convergence tolerance (default 1e-6)\n"
+          "  --itr-max <int>    Maximum number of iterations (default "
+          "1000000)\n"
+          "  --cfl <float>      CFL number (default based on Re)\n"
+          "  --c2 <float>       Artificial sound speed squared (default based "
+          "on Re)\n"
+          "  --check-itr <int>  Iterations between residual checks (default "
+          "1)\n"
+          "  --checkpoint <int> Iterations between checkpoints (default none)\n"
+          "  --restart          Resume from the latest checkpoint\n"
+          "  --log-itr <int>    Iterations between logged residuals (default "
+          "1)\n"
+          "  --log-binary       Log the residuals in binary to "
+          "data/residual.bin\n"
+          "  --adapt <int>      Iterations between adjustments of the CFL "
+          "number (default none)\n"
+          "  --sample <int>     Iterations between samples of the centrelines "
+          "(default once converged)\n"
+          "  --probe x=<float>  Sample the line x = const (or y = const) too\n"
+          "  --ghia <dir>       Score the centrelines against the tables of "
+          "Ghia et al. in dir\n"
+          "  --ensemble <list>  Solve the comma separated Reynolds numbers "
+          "together\n"
+          "  --sequence <list>  Solve the comma separated n x n grids one "
+          "after another\n"
+          "  --coarse-tol <float> Convergence tolerance of the coarse grids "
+          "(default tol)\n"
+          "  --init <file>      Start from the fields described by an "
+          "earlier uvp.json\n"
+          "  --weight <float>   Relative speed of the process, sizing its "
+          "share of the grid (default 1)\n"
+          "  -h, --help         Print the usage\n",
+          name, IX, IY);
+}
+
+/* Parse a number that must be positive; returns 0 if it is not */
+static int positive(const char *opt, const char *arg, double *x) {
+  char *ptr;
+
+  *x = strtod(arg, &ptr);
+  if (ptr == arg || *ptr != '\0' || !(*x > 0.0)) {
+    fprintf(stderr, "Invalid value '%s' for %s\n", arg, opt);
+    return 0;
+  }
+  return 1;
+}
+
+/* Parse a whole number that must be positive and fit in an int; returns 0 if
+ * it does not */
+static int positive_int(const char *opt, const char *arg, int *n) {
+  char *ptr;
+  long x;
+
+  errno = 0;
+  x = strtol(arg, &ptr, 10);
+  if (ptr == arg || *ptr != '\0' || errno == ERANGE || x < 1 ||
+      x > INT_MAX) {
+    fprintf(stderr, "Invalid value '%s' for %s, expected a whole number from "
+                    "1 to %d\n",
+            arg, opt, INT_MAX);
+    return 0;
+  }
+  *n = (int)x;
+  return 1;
+}
+
+/* Parse a line sampled along, x=<float> or y=<float>, after the
+ * centrelines; returns 0 if it is invalid */
+static int probe(const char *arg, struct SimulationInfo *s) {
+  char *ptr;
+  double x;
+
+  if ((arg[0] != 'x' && arg[0] != 'y') || arg[1] != '=') {
+    fprintf(stderr, "Invalid line '%s' for probe, expected x=<float> or "
+                    "y=<float>\n",
+            arg);
+    return 0;
+  }
+  x = strtod(arg + 2, &ptr);
+  if (ptr == arg + 2 || *ptr != '\0' || !(x >= 0.0 && x <= s->l_lid)) {
+    fprintf(stderr, "Invalid value '%s' for probe\n", arg);
+    return 0;
+  }
+  s->nlines = s->nlines > 2 ? s->nlines : 2;
+  if (s->nlines == SAMPLE_LINES) {
+    fprintf(stderr, "At most %d lines can be probed\n", SAMPLE_LINES - 2);
+    return 0;
+  }
+  s->line_dir[s->nlines] = (arg[0] == 'y');
+  s->line_pos[s->nlines++] = x;
+  return 1;
+}
+
+/* Parse the comma separated Reynolds numbers of an ensemble; returns 0 if
+ * they are invalid */
+static int ensemble(const char *arg, struct SimulationInfo *s) {
+  char list[1024], *tok, *save;
+
+  snprintf(list, sizeof(list), "%s", arg);
+  s->nmembers = 0;
+  for (tok = strtok_r(list, ",", &save); tok;
+       tok = strtok_r(NULL, ",", &save)) {
+    double *re = &s->members[s->nmembers];
+
+    if (s->nmembers == ENSEMBLE_MEMBERS) {
+      fprintf(stderr, "At most %d members in an ensemble\n",
+              ENSEMBLE_MEMBERS);
+      return 0;
+    }
+    if (!positive("ensemble", tok, re)) {
+      return 0;
+    }
+    /* Each member writes to its own directory, named after Re */
+    for (int k = 0; k < s->nmembers; k++) {
+      if (s->members[k] == *re) {
+        fprintf(stderr, "Re = %g is twice in the ensemble\n", *re);
+        return 0;
+      }
+    }
+    s->nmembers++;
+  }
+  if (s->nmembers == 0) {
+    fprintf(stderr, "Invalid value '%s' for ensemble\n", arg);
+    return 0;
+  }
+  return 1;
+}
+
+/* Parse the comma separated grid sizes of a sequence, growing from one to
+ * the next; returns 0 if they are invalid */
+static int sequence(const char *arg, struct SimulationInfo *s) {
+  char list[1024], *tok, *save, *ptr;
+
+  snprintf(list, sizeof(list), "%s", arg);
+  s->nlevels = 0;
+  for (tok = strtok_r(list, ",", &save); tok;
+       tok = strtok_r(NULL, ",", &save)) {
+    long n = strtol(tok, &ptr, 10);
+
+    if (s->nlevels == SEQUENCE_LEVELS) {
+      fprintf(stderr, "At most %d grids in a sequence\n", SEQUENCE_LEVELS);
+      return 0;
+    }
+    if (ptr == tok || *ptr != '\0' || n < 3 ||
+        (s->nlevels > 0 && n <= s->levels[s->nlevels - 1])) {
+      fprintf(stderr, "Invalid value '%s' for sequence, the grids must "
+                      "grow from 3 points on\n",
+              tok);
+      return 0;
+    }
+    s->levels[s->nlevels++] = (int)n;
+  }
+  if (s->nlevels == 0) {
+    fprintf(stderr, "Invalid value '%s' for sequence\n", arg);
+    return 0;
+  }
+  return 1;
+}
+
+/* Parse the command line; returns -1 to go on, or the exit status */
+static int parse(int argc, char *argv[], struct Grid2D *g,
+                 struct SimulationInfo *s) {
+  int opt, k, ok = 1;
+  const char *name;
+  static const struct option options[] = {
+      {"nx", required_argument, 0, 'x'},
+      {"ny", required_argument, 0, 'y'},
+      {"Re", required_argument, 0, 'r'},
+      {"tol", required_argument, 0, 't'},
+      {"itr-max", required_argument, 0, 'i'},
+      {"cfl", required_argument, 0, 'f'},
+      {"c2", required_argument, 0, 'c'},
+      {"check-itr", required_argument, 0, 'k'},
+      {"checkpoint", required_argument, 0, 's'},
+      {"restart", no_argument, 0, 'R'},
+      {"log-itr", required_argument, 0, 'l'},
+      {"log-binary", no_argument, 0, 'b'},
+      {"adapt", required_argument, 0, 'a'},
+      {"sample", required_argument, 0, 'S'},
+      {"probe", required_argument, 0, 'p'},
+      {"ghia", required_argument, 0, 'g'},
+      {"ensemble", required_argument, 0, 'E'},
+      {"sequence", required_argument, 0, 'q'},
+      {"coarse-tol", required_argument, 0, 'T'},
+      {"init", required_argument, 0, 'I'},
+      {"weight", required_argument, 0, 'w'},
+      {"help", no_argument, 0, 'h'},
+      {0, 0, 0, 0}};
+
+  while (ok && (opt = getopt_long(argc, argv, "h", options, &k)) != -1) {
+    if (opt == 'h') {
+      usage(argv[0], stdout);
+      return EXIT_SUCCESS;
+    }
+    if (opt == '?') {
+      ok = 0;
+      break;
+    }
+    if (opt == 'R') {
+      s->restart = 1;
+      continue;
+    }
+    if (opt == 'b') {
+      s->log_binary = 1;
+      continue;
+    }
+    if (opt == 'g') {
+      s->ghia = optarg;
+      s->nlines = s->nlines > 2 ? s->nlines : 2;
+      continue;
+    }
+    if (opt == 'p') {
+      ok = probe(optarg, s);
+      continue;
+    }
+    if (opt == 'E') {
+      ok = ensemble(optarg, s);
+      continue;
+    }
+    if (opt == 'q') {
+      ok = sequence(optarg, s);
+      continue;
+    }
+    if (opt == 'I') {
+      s->init = optarg;
+      s->warm = 1;
+      continue;
+    }
+
+    name = options[k].name;
+    switch (opt) {
+    case 'x':
+      ok = positive_int(name, optarg, &g->nx);
+      break;
+    case 'y':
+      ok = positive_int(name, optarg, &g->ny);
+      break;
+    case 'r':
+      ok = positive(name, optarg, &s->Re);
+      break;
+    case 't':
+      ok = positive(name, optarg, &s->tol);
+      break;
+    case 'i':
+      ok = positive_int(name, optarg, &s->itr_max);
+      break;
+    case 'f':
+      ok = positive(name, optarg, &s->cfl);
+      break;
+    case 'c':
+      ok = positive(name, optarg, &s->c2);
+      break;
+    case 'k':
+      ok = positive_int(name, optarg, &s->check_itr);
+      break;
+    case 's':
+      ok = positive_int(name, optarg, &s->ckpt_itr);
+      break;
+    case 'l':
+      ok = positive_int(name, optarg, &s->log_itr);
+      break;
+    case 'a':
+      ok = positive_int(name, optarg, &s->adapt_itr);
+      break;
+    case 'S':
+      ok = positive_int(name, optarg, &s->sample_itr);
+      s->nlines = s->nlines > 2 ? s->nlines : 2;
+      break;
+    case 'T':
+      ok = positive(name, optarg, &s->coarse_tol);
+      break;
+    case 'w':
+      ok = positive(name, optarg, &s->weight);
+      break;
+    }
+  }
+
+  /* The last grid of a sequence is the one solved; the changes of the
+   * fields in an iteration scale with the grid spacing, so the coarse grids
+   * are solved much more loosely with the same tolerance already */
+  if (ok && s->nlevels > 0) {
+    g->nx = g->ny = s->levels[s->nlevels - 1];
+    s->coarse_tol = s->coarse_tol > 0.0 ? s->coarse_tol : s->tol;
+  }
+
+  /* Reynolds number and number of iterations between residual checks may
+   * also be given as arguments */
+  if (ok && optind < argc) {
+    ok = positive("Re", argv[optind++], &s->Re);
+  }
+  if (ok && optind < argc) {
+    ok = positive_int("check_itr", argv[optind++], &s->check_itr);
+  }
+
+  /* At least one interior point of each field in each direction */
+  if (ok && (g->nx < 3 || g->ny < 3)) {
+    fprintf(stderr, "The grid needs at least 3 x 3 points\n");
+    ok = 0;
+  }
+  /* The points of a field, its rows padded to a cache line, are indexed with
+   * an int */
+  if (ok && ((double)g->nx + 2) * ((double)g->ny + 2 + ALIGN) > INT_MAX) {
+    fprintf(stderr, "The grid of %d x %d points is too large\n", g->nx, g->ny);
+    ok = 0;
+  }
+  if (ok && (s->itr_max < 1 || s->check_itr < 1 || s->log_itr < 1)) {
+    fprintf(stderr, "The number of iterations must be at least 1\n");
+    ok = 0;
+  }
+  /* Each half of a window of the controller needs a residual check */
+  if (ok && s->adapt_itr > 0 && s->adapt_itr < 2 * s->check_itr) {
+    fprintf(stderr, "--adapt needs at least 2 residual checks per window\n");
+    ok = 0;
+  }
+
+  /* The members of an ensemble, and the grids of a sequence, start on their
+   * own */
+  if (ok && (s->nlevels > 0 || s->warm) && (s->restart || s->nmembers > 0)) {
+    fprintf(stderr, "--sequence and --init do not work with --restart or "
+                    "--ensemble\n");
+    ok = 0;
+  }
+
+  /* The members neither checkpoint nor share a persistent parallel region */
+  if (ok && s->nmembers > 0 && (s->ckpt_itr > 0 || s->restart)) {
+    fprintf(stderr, "--ensemble does not work with --checkpoint or "
+                    "--restart\n");
+    ok = 0;
+  }
+#ifdef PERSISTENT
+  if (ok && s->nmembers > 0) {
+    fprintf(stderr, "--ensemble does not work with USE_PERSISTENT\n");
+    ok = 0;
+  }
+#endif
+
+  if (!ok) {
+    usage(argv[0], stderr);
+    return EXIT_FAILURE;
+  }
+  return -1;
+}
+
+/* Set the grid size and the case parameters from the command line on MASTER
+ * and broadcast them */
+void read_config(int argc, char *argv[], struct Grid2D *g,
+                 struct SimulationInfo *s, int rank) {
+  int status = -1;
+
+  g->nx = IX;
+  g->ny = IY;
+  s->Re = 100.0;
+  s->tol = 1.0e-6;
+  s->itr_max = 1000000;
+  s->check_itr = 1;
+  s->ckpt_itr = 0;
+  s->restart = 0;
+  s->log_itr = 1;
+  s->log_binary = 0;
+  s->adapt_itr = 0;
+  s->weight = 1.0;
+  s->sample_itr = 0;
+  s->ghia = NULL;
+  s->nmembers = 0;
+  s->nlevels = 0;
+  s->coarse_tol = 0.0;
+  s->warm = 0;
+  s->init = NULL;
+  strcpy(s->data, "data");
+
+  /* The centrelines come first among the sampled lines */
+  s->nlines = 0;
+  s->line_dir[0] = 0;
+  s->line_dir[1] = 1;
+  s->line_pos[0] = s->line_pos[1] = 0.5 * s->l_lid;
+
+  if (MASTER) {
+    status = parse(argc, argv, g, s);
+  }
+  MPI_Bcast(&status, 1, MPI_INT, 0, WORLD);
+  if (status >= 0) {
+    MPI_Finalize();
+    exit(status);
+  }
+
+  MPI_Bcast(&g->nx, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&g->ny, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->Re, 1, MPI_DOUBLE, 0, WORLD);
+  MPI_Bcast(&s->tol, 1, MPI_DOUBLE, 0, WORLD);
+  MPI_Bcast(&s->itr_max, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->cfl, 1, MPI_DOUBLE, 0, WORLD);
+  MPI_Bcast(&s->c2, 1, MPI_DOUBLE, 0, WORLD);
+  MPI_Bcast(&s->check_itr, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->ckpt_itr, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->restart, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->log_itr, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->log_binary, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->adapt_itr, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->sample_itr, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->nlines, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(s->line_dir, SAMPLE_LINES, MPI_INT, 0, WORLD);
+  MPI_Bcast(s->line_pos, SAMPLE_LINES, MPI_DOUBLE, 0, WORLD);
+  MPI_Bcast(&s->nlevels, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(s->levels, SEQUENCE_LEVELS, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->coarse_tol, 1, MPI_DOUBLE, 0, WORLD);
+  MPI_Bcast(&s->warm, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->nmembers, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(s->members, ENSEMBLE_MEMBERS, MPI_DOUBLE, 0, WORLD);
+
+  /* The weight is each process' own, e.g. from its part of an MPMD launch
+   * such as mpirun -np 32 lidCavity : -np 16 lidCavity --weight 0.5 */
+  for (int k = 1; NODE && k < argc; k++) {
+    const char *arg = NULL;
+
+    if (strcmp(argv[k], "--weight") == 0 && k + 1 < argc) {
+      arg = argv[k + 1];
+    } else if (strncmp(argv[k], "--weight=", 9) == 0) {
+      arg = argv[k] + 9;
+    }
+    if (arg && !positive("weight", arg, &s->weight)) {
+      MPI_Abort(WORLD, EXIT_FAILURE);
+    }
+  }
+}
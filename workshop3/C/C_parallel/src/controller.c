@@ -0,0 +1,177 @@
+#include "controller.h"
+
+/* Factors the CFL number is raised and cut by */
+#define CFL_UP 1.1
+#define CFL_DOWN 0.7
+
+/* Fraction of the lowest CFL number that failed the CFL number is raised up
+ * to */
+#define CFL_CLEAR 0.9
+
+/* Growth of the residuals over a window taken for an instability; below it
+ * they may grow with the flow developing */
+#define GROWTH 2.0
+
+/* Lowest CFL number tried, relative to the one the run started with */
+#define CFL_MIN 1e-3
+
+/* Number of windows in a row projected to end after the maximum number of
+ * iterations before the run is stopped */
+#define LATE_WINDOWS 10
+
+/* Copy n values of a field, on the device with OFFLOAD */
+static void copy(real *restrict dst, const real *restrict src, size_t n) {
+#ifdef OFFLOAD
+#pragma omp target teams distribute parallel for
+#else
+#pragma omp parallel for schedule(static)
+#endif
+  for (size_t i = 0; i < n; i++) {
+    dst[i] = src[i];
+  }
+}
+
+/* Largest residual of u, v and p. The divergence is left out: it swings by
+ * orders of magnitude while the others go down steadily. */
+static double residual(struct SimulationInfo *s) {
+  return fmax(fmax(s->errs[1], s->errs[2]), s->errs[3]);
+}
+
+/* Start controlling from the current fields, which iteration itr starts
+ * from */
+void adapt_init(struct Controller *c, struct FieldPointers *f,
+                struct Grid2D *g, struct SimulationInfo *s, int itr) {
+  size_t n = (size_t)(g->nx_p + 2) * g->stride;
+
+  c->save = field_2D(3 * (g->nx_p + 2), g->stride);
+#ifdef OFFLOAD
+#pragma omp target enter data map(alloc: c->save[0:3 * n])
+#endif
+  copy(c->save, f->u, n);
+  copy(c->save + n, f->v, n);
+  copy(c->save + 2 * n, f->p, n);
+
+  c->itr = itr - 1;
+  c->first = c->second = 0.0;
+  c->cfl0 = s->cfl;
+  c->dt0 = s->dt;
+  c->ceiling = INFINITY;
+  c->late = 0;
+}
+
+/* Rescale the residuals to the time step the run started with, so that the
+ * tolerance means the same whatever the time step; the changes of u, v and p
+ * in an iteration, and the divergence, grow as dt and their norms by sqrt(dt)
+ * more */
+void adapt_residuals(struct Controller *c, struct SimulationInfo *s) {
+  double q = c->dt0 / s->dt;
+  int count = 4;
+
+  s->errs[1] *= pow(q, 1.5);
+  s->errs[2] *= pow(q, 1.5);
+  s->errs[3] *= pow(q, 1.5);
+  s->errs[4] *= pow(q, 1.5);
+  s->errs[0] = fmaxof(count, s->errs[1], s->errs[2], s->errs[3], s->errs[4]);
+}
+
+/* Look at the residuals of iteration itr, computed by l2_norm, before the
+ * fields are updated; returns the iteration to carry on from. The residuals
+ * are left NaN if the time step cannot be cut any further. */
+int adapt(struct Controller *c, struct FieldPointers *f, struct Grid2D *g,
+          struct SimulationInfo *s, int itr, int rank) {
+  size_t n = (size_t)(g->nx_p + 2) * g->stride;
+  real *fields[3] = {f->un, f->vn, f->pn};
+  int k;
+
+  /* The halves of a window run with the same time step, so whether the
+   * residuals go down, or blow up, is told by comparing them */
+  if (isfinite(s->errs[1] + s->errs[2] + s->errs[3] + s->errs[4])) {
+    int len = itr - c->itr;
+
+    if (2 * len <= s->adapt_itr) {
+      c->first = fmax(c->first, residual(s));
+    } else {
+      c->second = fmax(c->second, residual(s));
+    }
+    if (len < s->adapt_itr) {
+      return itr;
+    }
+
+    if (c->second <= GROWTH * c->first) {
+      /* Project the rate of the window on to the tolerance */
+      double rate = log(c->first / c->second) / (0.5 * len);
+      double left = rate > 0.0 ? log(residual(s) / s->tol) / rate : INFINITY;
+
+      if (MASTER && rate > 0.0) {
+        printf("Iteration %d: cfl %.4g, about %.0f iterations to go\n", itr,
+               s->cfl, fmax(left, 0.0));
+      } else if (MASTER) {
+        printf("Iteration %d: cfl %.4g, residuals not going down\n", itr,
+               s->cfl);
+      }
+      c->late = (itr + left > s->itr_max) ? c->late + 1 : 0;
+      if (c->late == LATE_WINDOWS) {
+        if (MASTER) {
+          printf("Not converging within %d iterations at this rate\n",
+                 s->itr_max);
+        }
+        return s->itr_max - 1;
+      }
+
+      /* The ghost layers of the new fields must be in place to copy them */
+      halo_wait(s->ureq);
+      halo_wait(s->vreq);
+      halo_wait(s->preq);
+      for (k = 0; k < 3; k++) {
+        copy(c->save + k * n, fields[k], n);
+      }
+      c->itr = itr;
+
+      /* Speed up only while the residuals go down, staying clear of the CFL
+       * number that failed */
+      if (c->second < c->first && CFL_UP * s->cfl < CFL_CLEAR * c->ceiling) {
+        s->cfl *= CFL_UP;
+        set_dt(g, s);
+      }
+      c->first = c->second = 0.0;
+      return itr;
+    }
+  }
+
+  /* The residuals blew up: go back to the end of the last good window with a
+   * smaller time step */
+  halo_wait(s->ureq);
+  halo_wait(s->vreq);
+  halo_wait(s->preq);
+  for (k = 0; k < 3; k++) {
+    copy(fields[k], c->save + k * n, n);
+  }
+  c->first = c->second = 0.0;
+  c->late = 0;
+
+  c->ceiling = fmin(c->ceiling, s->cfl);
+  s->cfl *= CFL_DOWN;
+  if (s->cfl < CFL_MIN * c->cfl0) {
+    s->errs[0] = NAN;
+    return itr;
+  }
+  set_dt(g, s);
+  s->errs[0] = INFINITY;
+  if (MASTER) {
+    printf("Iteration %d: residuals blew up, back to iteration %d with cfl "
+           "%.4g\n",
+           itr, c->itr, s->cfl);
+  }
+  return c->itr;
+}
+
+/* Free the copy of the fields */
+void adapt_free(struct Controller *c, struct Grid2D *g) {
+#ifdef OFFLOAD
+  size_t n = (size_t)(g->nx_p + 2) * g->stride;
+
+#pragma omp target exit data map(delete: c->save[0:3 * n])
+#endif
+  free(c->save);
+  c->save = NULL;
+}
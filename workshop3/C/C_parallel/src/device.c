@@ -0,0 +1,112 @@
+#include "device.h"
+
+#ifdef OFFLOAD
+/* Select a device for the process and map the fields onto it */
+void device_init(struct Grid2D *g, struct SimulationInfo *s, int rank) {
+  int ndev = omp_get_num_devices(), node_rank, nx = g->nx_p;
+  size_t n = (size_t)(g->nx_p + 2) * g->stride;
+  MPI_Comm node;
+
+  /* The processes of a node are spread over its devices in turn */
+  MPI_Comm_split_type(WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL,
+                      &node);
+  MPI_Comm_rank(node, &node_rank);
+  MPI_Comm_free(&node);
+  if (ndev > 0) {
+    omp_set_default_device(node_rank % ndev);
+  } else if (MASTER) {
+    printf("No device found, the offloaded loops run on the host\n");
+  }
+
+#pragma omp target enter data map(to: g->ubufo[0:n], g->ubufn[0:n],      \
+                                      g->vbufo[0:n], g->vbufn[0:n],      \
+                                      g->pbufo[0:n], g->pbufn[0:n],      \
+                                      g->hbuf[0:4 * nx])
+}
+
+/* Copy u, v and p from the device to the host */
+void device_get(struct FieldPointers *f, struct Grid2D *g) {
+  size_t n = (size_t)(g->nx_p + 2) * g->stride;
+
+#pragma omp target update from(f->u[0:n], f->v[0:n], f->p[0:n])
+}
+
+/* Copy u, v and p from the host to the device */
+void device_put(struct FieldPointers *f, struct Grid2D *g) {
+  size_t n = (size_t)(g->nx_p + 2) * g->stride;
+
+#pragma omp target update to(f->u[0:n], f->v[0:n], f->p[0:n])
+}
+
+/* Exchange the ghost layers of a field resident on the device in the same
+ * order as exchange_halo. Only the exchanged points cross to the host, or
+ * none of them with a GPU-aware MPI. */
+void exchange_halo_device(real *arr, struct Grid2D *g,
+                          struct SimulationInfo *s) {
+  int i, tag = 0, nx = g->nx_p, ny = g->ny_p, st = g->stride;
+  /* Whether there are neighbors to exchange with */
+  const int top = !TOP_WALL, bottom = !BOTTOM_WALL;
+#ifndef GPU_AWARE_MPI
+  const int left = !LEFT_WALL, right = !RIGHT_WALL;
+#endif
+  real *buf = g->hbuf;
+
+  TIMER_START(T_HALO);
+  /* Top and bottom: a column of the owned rows is strided, so it is packed
+   * on the device first */
+#pragma omp target teams distribute parallel for
+  for (i = 0; i < nx; i++) {
+    buf[i] = arr[IDX(i + 1, ny)];
+    buf[nx + i] = arr[IDX(i + 1, 1)];
+  }
+
+#ifdef GPU_AWARE_MPI
+#pragma omp target data use_device_ptr(buf)
+  {
+#else
+#pragma omp target update from(buf[0:2 * nx]) if (top || bottom)
+#endif
+    MPI_Sendrecv(buf, nx, REAL_MPI, s->nbr[0], tag, buf + 2 * nx, nx,
+                 REAL_MPI, s->nbr[2], tag, s->comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(buf + nx, nx, REAL_MPI, s->nbr[2], tag, buf + 3 * nx, nx,
+                 REAL_MPI, s->nbr[0], tag, s->comm, MPI_STATUS_IGNORE);
+#ifdef GPU_AWARE_MPI
+  }
+#else
+#pragma omp target update to(buf[2 * nx:2 * nx]) if (top || bottom)
+#endif
+
+#pragma omp target teams distribute parallel for
+  for (i = 0; i < nx; i++) {
+    if (bottom) {
+      arr[IDX(i + 1, 0)] = buf[2 * nx + i];
+    }
+    if (top) {
+      arr[IDX(i + 1, ny + 1)] = buf[3 * nx + i];
+    }
+  }
+
+  /* Right and left: whole rows, which are contiguous, so the corners come
+   * along */
+#ifdef GPU_AWARE_MPI
+#pragma omp target data use_device_ptr(arr)
+  {
+#else
+#pragma omp target update from(arr[IDX(nx, 0):ny + 2]) if (right)
+#pragma omp target update from(arr[IDX(1, 0):ny + 2]) if (left)
+#endif
+    MPI_Sendrecv(&arr[IDX(nx, 0)], ny + 2, REAL_MPI, s->nbr[3], tag,
+                 &arr[IDX(0, 0)], ny + 2, REAL_MPI, s->nbr[1], tag, s->comm,
+                 MPI_STATUS_IGNORE);
+    MPI_Sendrecv(&arr[IDX(1, 0)], ny + 2, REAL_MPI, s->nbr[1], tag,
+                 &arr[IDX(nx + 1, 0)], ny + 2, REAL_MPI, s->nbr[3], tag,
+                 s->comm, MPI_STATUS_IGNORE);
+#ifdef GPU_AWARE_MPI
+  }
+#else
+#pragma omp target update to(arr[IDX(0, 0):ny + 2]) if (left)
+#pragma omp target update to(arr[IDX(nx + 1, 0):ny + 2]) if (right)
+#endif
+  TIMER_STOP();
+}
+#endif /* OFFLOAD */
@@ -0,0 +1,85 @@
+#include "ensemble.h"
+
+/* Whether the command line asks for an ensemble, which needs
+ * MPI_THREAD_MULTIPLE to advance its members on several threads at once */
+int ensemble_requested(int argc, char *argv[]) {
+  for (int k = 1; k < argc; k++) {
+    if (strncmp(argv[k], "--ensemble", 10) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Solve the cases of Re = s->members[k] together; returns the exit status */
+int run_ensemble(struct Grid2D *g, struct SimulationInfo *s, int rank,
+                 int nprocs, int provided) {
+  struct Member *m = (struct Member *)calloc(s->nmembers, sizeof(*m));
+  struct Member **live =
+      (struct Member **)malloc(sizeof(*live) * s->nmembers);
+  int state[ENSEMBLE_MEMBERS], nlive = s->nmembers, nthreads = 1, spread = 0;
+  int k, status = EXIT_SUCCESS;
+
+#ifdef _OPENMP
+  /* Device kernels are launched by the host thread alone, one member after
+   * another */
+  nthreads = omp_get_max_threads();
+#ifndef OFFLOAD
+  spread = (provided >= MPI_THREAD_MULTIPLE);
+#endif
+  omp_set_max_active_levels(2);
+#endif
+  if (MASTER) {
+    printf("Solving an ensemble of %d members on %d threads\n", nlive,
+           nthreads);
+    if (nthreads > 1 && !spread) {
+      printf("The members are advanced one after another\n");
+    }
+  }
+
+  for (k = 0; k < nlive; k++) {
+    struct SimulationInfo sk = *s;
+
+    sk.Re = s->members[k];
+    snprintf(sk.data, sizeof(sk.data), "data/Re%g", sk.Re);
+    member_start(&m[k], g, &sk, NULL, rank, nprocs);
+    live[k] = &m[k];
+  }
+
+  TIMER_INIT();
+  while (nlive > 0) {
+    /* Each member gets a thread, and the threads left over go to their
+     * kernels; the members of a thread are the same ones, in the same order,
+     * on all the processes, so their collectives match up */
+    int n = 0;
+#ifdef _OPENMP
+    int outer = spread ? (nlive < nthreads ? nlive : nthreads) : 1;
+
+#pragma omp parallel for num_threads(outer) schedule(static)
+#endif
+    for (k = 0; k < nlive; k++) {
+#ifdef _OPENMP
+      omp_set_num_threads(nthreads / outer);
+#endif
+      state[k] = member_advance(live[k], ENSEMBLE_BATCH, rank);
+    }
+
+    /* Retire the members that are done and close up the others */
+    for (k = 0; k < nlive; k++) {
+      if (state[k] == RUNNING) {
+        live[n++] = live[k];
+        continue;
+      }
+      member_finish(live[k], state[k], rank, nprocs);
+      if (state[k] != CONVERGED) {
+        status = EXIT_FAILURE;
+      }
+    }
+    nlive = n;
+  }
+  TIMER_REPORT(rank, nprocs);
+
+  free(live);
+  free(m);
+  return status;
+}
@@ -26,94 +26,236 @@ Boundary Conditions: u, v -> Dirichlet (as shown below)
                              ---------------
                                   u=0, v=0
 \*============================================================================*/
+#include "checkpoint.h"
+#include "config.h"
+#include "controller.h"
+#include "ensemble.h"
+#include "residualLog.h"
+#include "sequence.h"
+#include "sampler.h"
 #include "simulationControls.h"
 #include "writer.h"
 
 int main(int argc, char *argv[]) {
-  int itr = 1, count = 6;
-  const double tol = 1.0e-6;
-  const int itr_max = 1000000;
+  int itr = 1, check;
 
-  FILE *flog;
+  /* Log of the residuals, on MASTER */
+  static struct ResidualLog flog;
+
+  /* Controller of the time step, with --adapt */
+  static struct Controller ctl;
+
+  /* Sampler of the centrelines and probed lines, with --sample, --probe or
+   * --ghia */
+  static struct Sampler smp;
+
+  /* Fields to start from, with --sequence or --init */
+  static struct Coarse coarse;
 
   int rank, nprocs, provided;
 
-  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+  /* The members of an ensemble communicate from their own threads */
+  MPI_Init_thread(&argc, &argv,
+                  ensemble_requested(argc, argv) ? MPI_THREAD_MULTIPLE
+                                                 : MPI_THREAD_FUNNELED,
+                  &provided);
   MPI_Comm_size(WORLD, &nprocs);
   MPI_Comm_rank(WORLD, &rank);
 
-  g.nx = IX;
-  g.ny = IY;
-
   /* Boundary conditions: {top, left, bottom, right} */
   s = ((struct SimulationInfo){.ubc = {1.0, 0.0, 0.0, 0.0},
                                .vbc = {0.0, 0.0, 0.0, 0.0},
                                .pbc = {0.0, 0.0, 0.0, 0.0}});
 
-  s.Re = 100.0;
   s.l_lid = 1.0;
 
-  /* Getting Reynolds number */
+  /* Getting grid size, Reynolds number and solver settings */
+  read_config(argc, argv, &g, &s, rank);
+  if (s.nmembers > 0) {
+    int status = run_ensemble(&g, &s, rank, nprocs, provided);
+
+    MPI_Finalize();
+    return status;
+  }
   if (MASTER) {
-    if (argc > 1) {
-      char *ptr;
-      s.Re = strtod(argv[1], &ptr);
-    }
     printf("Re number is set to %d\n", (int)s.Re);
+    printf("Grid size is set to %d x %d\n", g.nx, g.ny);
+    printf("Residuals are checked every %d iterations\n", s.check_itr);
+#ifdef _OPENMP
+    printf("Running %d processes with %d threads each\n", nprocs,
+           omp_get_max_threads());
+    if (provided < MPI_THREAD_FUNNELED) {
+      printf("Warning: MPI does not provide MPI_THREAD_FUNNELED\n");
+    }
+#endif
 
-    /* Create a log file for outputting the residuals */
-    flog = fopen("data/residual", "w+t+e");
+    /* Create a log file for outputting the residuals, or carry on with the
+     * one of the run being resumed */
+    log_open(&flog, s.data, s.log_binary, s.restart);
+  }
+
+  /* Solve the coarse grids first, for the fields to start from */
+  if (s.warm) {
+    read_coarse(&coarse, s.init, rank);
+  }
+  if (s.nlevels > 1) {
+    run_sequence(&coarse, &g, &s, rank, nprocs);
   }
-  MPI_Bcast(&s.Re, 1, MPI_DOUBLE, 0, WORLD);
 
   initialize(&f, &g, &s, rank, nprocs);
-  set_init(&f, &g, &s);
-  set_BC(&f, &g, &s, rank, nprocs);
-  update(&f);
+  if (s.restart) {
+    itr = read_checkpoint(&f, &g, &s, rank);
+#ifdef OFFLOAD
+    device_put(&f, &g);
+#endif
+  } else if (coarse.file[0]) {
+    if (MASTER) {
+      printf("Starting from the fields of a %d x %d grid\n", coarse.nx,
+             coarse.ny);
+    }
+    prolong(&coarse, &f, &g, &s, rank);
+  } else {
+    set_init(&f, &g, &s);
+    set_UBC(&f, &g, &s);
+    set_PBC(&f, &g, &s);
+    update(&f);
+  }
+  if (s.adapt_itr > 0) {
+    adapt_init(&ctl, &f, &g, &s, itr);
+  }
+  if (s.nlines > 0) {
+    sample_init(&smp, &g, &s, rank);
+  }
 
-  /* Start the main loop */
-  do {
-    solve_U(&f, &g, &s);
-    solve_P(&f, &g, &s);
-    set_BC(&f, &g, &s, rank, nprocs);
-    l2_norm(&f, &g, &s, rank, nprocs);
+  /* Start the main loop. With PERSISTENT the threads stay in a single
+   * parallel region for the whole of it and share the kernels' loops, while
+   * the main thread alone applies the boundary conditions, communicates and
+   * writes; outside of such a region masked and barrier do nothing. */
+  TIMER_INIT();
+#ifdef PERSISTENT
+#pragma omp parallel private(check)
+#endif
+  {
+    do {
+      /* Only the main thread changes itr, just before the last barrier */
+      check = (itr % s.check_itr == 0);
 
-    if (MASTER) {
-      /* Check if solution diverged */
-      if (isnan(s.errs[0])) {
-        printf("Solution Diverged after %d iterations!\n", itr);
-        /* Free the memory and terminate */
-        count = 6;
-        freeMem(count, g.ubufo, g.vbufo, g.pbufo, g.ubufn, g.vbufn, g.pbufn);
-        exit(EXIT_FAILURE);
+      solve_U(&f, &g, &s);
+#pragma omp masked
+      set_UBC(&f, &g, &s);
+#pragma omp barrier
+      solve_P(&f, &g, &s);
+#pragma omp masked
+      set_PBC(&f, &g, &s);
+
+      /* All the processes get the same residuals, so they all take the same
+       * decision without any further communication */
+      if (check) {
+#pragma omp barrier
+        l2_norm(&f, &g, &s);
+
+        /* Check if solution diverged, unless the controller steps back */
+        if (isnan(s.errs[0]) && s.adapt_itr == 0) {
+          break;
+        }
       }
-      fprintf(flog, "%d\t%.8lf\t%.8lf\t%.8lf\t%.8lf\t%.8lf\n", itr, s.errs[0],
-              s.errs[1], s.errs[2], s.errs[3], s.errs[4]);
-      itr += 1;
-    }
-    MPI_Bcast(&s.errs[0], 1, MPI_DOUBLE, 0, WORLD);
-    MPI_Bcast(&itr, 1, MPI_INT, 0, WORLD);
 
-    /* Update the fields */
-    update(&f);
+#pragma omp masked
+      {
+        /* Logging and checkpoints, and the update, which costs nothing */
+        TIMER_START(T_OUTPUT);
+        if (check && s.adapt_itr > 0) {
+          adapt_residuals(&ctl, &s);
+        }
+        if (check && MASTER && (itr % s.log_itr == 0 || s.errs[0] <= s.tol)) {
+          log_residuals(&flog, itr, s.errs);
+        }
 
-  } while (s.errs[0] > tol && itr < itr_max);
+        /* Adjust the time step, possibly going back to an earlier iteration */
+        if (check && s.adapt_itr > 0) {
+          itr = adapt(&ctl, &f, &g, &s, itr, rank);
+        }
 
-  if (MASTER) {
-    if (itr == itr_max) {
-      printf("Maximum number of iterations, %d, exceeded\n", itr);
+        /* Update the fields */
+        update(&f);
 
-      /* Free the memory and terminate */
-      count = 6;
-      freeMem(count, g.ubufo, g.vbufo, g.pbufo, g.ubufn, g.vbufn, g.pbufn);
-      exit(EXIT_FAILURE);
+        /* Save the fields for resuming from the next iteration */
+        if (s.ckpt_itr > 0 && itr % s.ckpt_itr == 0) {
+          halo_wait(s.ureq);
+          halo_wait(s.vreq);
+          halo_wait(s.preq);
+#ifdef OFFLOAD
+          device_get(&f, &g);
+#endif
+          checkpoint(&f, &g, &s, itr, rank);
+          if (MASTER) {
+            log_flush(&flog);
+          }
+        }
+
+        /* Sample the lines, gathering only them rather than the fields */
+        if (s.sample_itr > 0 && itr % s.sample_itr == 0) {
+          sample(&smp, &f, &g, &s, itr, rank);
+        }
+        TIMER_STOP();
+        itr += 1;
+      }
+#pragma omp barrier
+    } while (!(check && s.errs[0] <= s.tol) && itr < s.itr_max &&
+             !isnan(s.errs[0]));
+  }
+  TIMER_REPORT(rank, nprocs);
+  if (s.adapt_itr > 0) {
+    adapt_free(&ctl, &g);
+  }
+
+  if (isnan(s.errs[0])) {
+    if (MASTER) {
+      printf("Solution Diverged after %d iterations!\n", itr);
+      log_close(&flog);
     }
+    /* Free the memory and terminate */
+    checkpoint_wait(&g, &s, rank);
+    free_fields(&g);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
 
+  if (itr == s.itr_max) {
+    if (MASTER) {
+      printf("Maximum number of iterations, %d, exceeded\n", itr);
+      log_close(&flog);
+    }
+
+    /* Free the memory and terminate */
+    checkpoint_wait(&g, &s, rank);
+    free_fields(&g);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  if (MASTER) {
     printf("Converged after %d iterations\n", itr);
-    fclose(flog);
+    log_close(&flog);
+  }
+
+  /* Complete the last exchange of the ghost layers, if still pending */
+  halo_wait(s.ureq);
+  halo_wait(s.vreq);
+  halo_wait(s.preq);
+  checkpoint_wait(&g, &s, rank);
+
+  if (s.nlines > 0) {
+    sample(&smp, &f, &g, &s, itr, rank);
+    sample_free(&smp);
   }
 
   /* Write output data */
-  dump_data(&g, &f, rank, nprocs);
+#ifdef OFFLOAD
+  device_get(&f, &g);
+#endif
+  dump_data(&g, &f, &s, rank, nprocs);
+
+  MPI_Finalize();
   return 0;
 }
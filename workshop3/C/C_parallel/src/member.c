@@ -0,0 +1,127 @@
+#include "member.h"
+
+/* Set up a case with the grid g and the settings of s, writing to s->data,
+ * which MASTER creates; it starts from the fields of a coarser grid c, or
+ * from the lid alone if c is NULL */
+void member_start(struct Member *m, struct Grid2D *g,
+                  struct SimulationInfo *s, const struct Coarse *c, int rank,
+                  int nprocs) {
+  m->g = *g;
+  m->s = *s;
+  if (MASTER && mkdir(m->s.data, 0755) != 0 && errno != EEXIST) {
+    printf("Cannot create %s\n", m->s.data);
+    MPI_Abort(WORLD, EXIT_FAILURE);
+  }
+
+  initialize(&m->f, &m->g, &m->s, rank, nprocs);
+  if (c) {
+    prolong(c, &m->f, &m->g, &m->s, rank);
+  } else {
+    set_init(&m->f, &m->g, &m->s);
+    set_UBC(&m->f, &m->g, &m->s);
+    set_PBC(&m->f, &m->g, &m->s);
+    update(&m->f);
+  }
+  m->itr = 1;
+
+  if (MASTER) {
+    log_open(&m->log, m->s.data, m->s.log_binary, 0);
+  }
+  if (m->s.adapt_itr > 0) {
+    adapt_init(&m->ctl, &m->f, &m->g, &m->s, m->itr);
+  }
+  if (m->s.nlines > 0) {
+    sample_init(&m->smp, &m->g, &m->s, rank);
+  }
+}
+
+/* Advance a case by up to n iterations, as the time loop of lidCavity does;
+ * returns its state */
+int member_advance(struct Member *m, int n, int rank) {
+  struct FieldPointers *f = &m->f;
+  struct Grid2D *g = &m->g;
+  struct SimulationInfo *s = &m->s;
+
+  for (int k = 0; k < n; k++) {
+    int check = (m->itr % s->check_itr == 0);
+
+    solve_U(f, g, s);
+    set_UBC(f, g, s);
+    solve_P(f, g, s);
+    set_PBC(f, g, s);
+
+    if (check) {
+      l2_norm(f, g, s);
+      if (isnan(s->errs[0]) && s->adapt_itr == 0) {
+        return DIVERGED;
+      }
+      if (s->adapt_itr > 0) {
+        adapt_residuals(&m->ctl, s);
+      }
+      if (MASTER && (m->itr % s->log_itr == 0 || s->errs[0] <= s->tol)) {
+        log_residuals(&m->log, m->itr, s->errs);
+      }
+      if (s->adapt_itr > 0) {
+        m->itr = adapt(&m->ctl, f, g, s, m->itr, rank);
+      }
+    }
+
+    update(f);
+    if (s->sample_itr > 0 && m->itr % s->sample_itr == 0) {
+      sample(&m->smp, f, g, s, m->itr, rank);
+    }
+    m->itr += 1;
+
+    if (isnan(s->errs[0])) {
+      return DIVERGED;
+    }
+    if (check && s->errs[0] <= s->tol) {
+      return CONVERGED;
+    }
+    if (m->itr >= s->itr_max) {
+      return EXCEEDED;
+    }
+  }
+  return RUNNING;
+}
+
+/* Retire a case: write its fields out if it converged and free all of its
+ * memory */
+void member_finish(struct Member *m, int state, int rank, int nprocs) {
+  struct SimulationInfo *s = &m->s;
+
+  if (MASTER) {
+    if (state == CONVERGED) {
+      printf("%s: converged after %d iterations\n", s->data, m->itr);
+    } else if (state == DIVERGED) {
+      printf("%s: diverged after %d iterations!\n", s->data, m->itr);
+    } else {
+      printf("%s: maximum number of iterations, %d, exceeded\n", s->data,
+             m->itr);
+    }
+    log_close(&m->log);
+  }
+  if (s->adapt_itr > 0) {
+    adapt_free(&m->ctl, &m->g);
+  }
+
+  halo_wait(s->ureq);
+  halo_wait(s->vreq);
+  halo_wait(s->preq);
+  if (state == CONVERGED) {
+    if (s->nlines > 0) {
+      sample(&m->smp, &m->f, &m->g, s, m->itr, rank);
+    }
+#ifdef OFFLOAD
+    device_get(&m->f, &m->g);
+#endif
+    dump_data(&m->g, &m->f, s, rank, nprocs);
+  } else {
+    free_fields(&m->g);
+    MPI_Type_free(&m->g.col);
+    MPI_Comm_free(&s->comm);
+  }
+  if (s->nlines > 0) {
+    sample_free(&m->smp);
+  }
+}
@@ -0,0 +1,207 @@
+#include "sampler.h"
+
+/* Add the values of u, v and p at the grid points along line x = pos if dir
+ * is 0, or y = pos if it is 1, owned by the process to out; the columns
+ * (rows) of grid points on either side of the line are weighted by their
+ * distance to it */
+static void extract(struct FieldPointers *f, struct Grid2D *g, int dir,
+                    double pos, double *out) {
+  const real *u = f->u, *v = f->v, *p = f->p;
+  int st = g->stride, n = dir ? g->nx : g->ny, ms, me, q;
+  /* Grid points across and along the line, and the block of the process */
+  int across = dir ? g->ny : g->nx;
+  int start = dir ? g->y0 : g->x0, size = dir ? g->ny_p : g->nx_p;
+  int along0 = dir ? g->x0 : g->y0;
+  double step = dir ? g->dy : g->dx, w;
+  int a0 = (int)floor(pos / step);
+
+  a0 = a0 < 0 ? 0 : (a0 > across - 2 ? across - 2 : a0);
+  w = pos / step - a0;
+  local_range(0, n, along0, dir ? g->nx_p : g->ny_p, &ms, &me);
+
+  for (q = 0; q < 2; q++) {
+    int c = a0 + q - start + 1;
+    double wt = q ? w : 1.0 - w;
+
+    if (c < 1 || c > size) {
+      continue;
+    }
+#ifdef OFFLOAD
+#pragma omp target teams distribute parallel for map(tofrom: out[0:3 * n])
+#endif
+    for (int m = ms; m < me; m++) {
+      int k = dir ? m : c, l = dir ? c : m, j = m - 1 + along0;
+
+      out[j] += wt * 0.5 * (u[IDX(k, l + 1)] + u[IDX(k, l)]);
+      out[n + j] += wt * 0.5 * (v[IDX(k + 1, l)] + v[IDX(k, l)]);
+      out[2 * n + j] += wt * 0.25 * (p[IDX(k, l)] + p[IDX(k + 1, l)] +
+                                     p[IDX(k, l + 1)] + p[IDX(k + 1, l + 1)]);
+    }
+  }
+}
+
+/* Value of a line of n grid points spaced by step at t */
+static double interpolate(const double *line, int n, double step, double t) {
+  int a = (int)floor(t / step);
+  double w;
+
+  a = a < 0 ? 0 : (a > n - 2 ? n - 2 : a);
+  w = t / step - a;
+  return (1.0 - w) * line[a] + w * line[a + 1];
+}
+
+/* Read the positions and the values at Re, in column col, of a table of
+ * Ghia et al. */
+static void read_table(const char *dir, const char *name, int col,
+                       double *pos, double *val, int *npts) {
+  char path[4096];
+  double row[5];
+  FILE *fd;
+
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  fd = fopen(path, "rte");
+  if (!fd) {
+    printf("Cannot read the table of Ghia et al. %s\n", path);
+    MPI_Abort(WORLD, EXIT_FAILURE);
+  }
+  *npts = 0;
+  while (*npts < GHIA_POINTS && fscanf(fd, "%lf %lf %lf %lf %lf", &row[0],
+                                       &row[1], &row[2], &row[3],
+                                       &row[4]) == 5) {
+    pos[*npts] = row[0];
+    val[*npts] = row[col];
+    (*npts)++;
+  }
+  fclose(fd);
+}
+
+/* Set up the sampling of the lines, and read the tables of Ghia et al. from
+ * s->ghia on MASTER */
+void sample_init(struct Sampler *sp, struct Grid2D *g,
+                 struct SimulationInfo *s, int rank) {
+  char path[128];
+  int col;
+
+  sp->len = 0;
+  for (int l = 0; l < s->nlines; l++) {
+    sp->offset[l] = sp->len;
+    sp->len += 3 * (s->line_dir[l] ? g->nx : g->ny);
+  }
+  sp->local = (double *)malloc(sizeof(double) * sp->len);
+  sp->global = MASTER ? (double *)malloc(sizeof(double) * sp->len) : NULL;
+  sp->fd = NULL;
+
+  if (!MASTER || !s->ghia) {
+    return;
+  }
+
+  /* Columns of the tables: the position, then Re = 100, 1000, 5000, 10000 */
+  col = s->Re == 100.0    ? 1
+        : s->Re == 1000.0  ? 2
+        : s->Re == 5000.0  ? 3
+        : s->Re == 10000.0 ? 4
+                           : 0;
+  if (col == 0) {
+    printf("No data of Ghia et al. for Re = %g, the centrelines are not "
+           "scored\n",
+           s->Re);
+    return;
+  }
+  read_table(s->ghia, "yu", col, sp->pos[0], sp->val[0], &sp->npts[0]);
+  read_table(s->ghia, "xv", col, sp->pos[1], sp->val[1], &sp->npts[1]);
+
+  snprintf(path, sizeof(path), "%s/ghia", s->data);
+  sp->fd = fopen(path, s->restart ? "a+t+e" : "w+t+e");
+  if (!sp->fd) {
+    printf("Cannot open the log of the scores in %s/\n", s->data);
+    MPI_Abort(WORLD, EXIT_FAILURE);
+  }
+  if (!s->restart) {
+    fprintf(sp->fd, "# iteration\tu rms\tu max\tv rms\tv max\n");
+  }
+}
+
+/* Sample the lines after iteration itr, and score the centrelines against
+ * the tables of Ghia et al.; all the processes of s->comm must call it */
+void sample(struct Sampler *sp, struct FieldPointers *f, struct Grid2D *g,
+            struct SimulationInfo *s, int itr, int rank) {
+  char name[128];
+  double rms[2], max[2];
+  FILE *fd;
+  int l, j;
+
+  /* The grid points next to the owned ones are in the ghost layers */
+  halo_wait(s->ureq);
+  halo_wait(s->vreq);
+  halo_wait(s->preq);
+
+  for (j = 0; j < sp->len; j++) {
+    sp->local[j] = 0.0;
+  }
+  for (l = 0; l < s->nlines; l++) {
+    extract(f, g, s->line_dir[l], s->line_pos[l], sp->local + sp->offset[l]);
+  }
+  /* Over the communicator of the case, as the members of an ensemble sample
+   * at the same time from their own threads; its ranks are those of WORLD */
+  MPI_Reduce(sp->local, sp->global, sp->len, MPI_DOUBLE, MPI_SUM, 0, s->comm);
+  if (!MASTER) {
+    return;
+  }
+
+  snprintf(name, sizeof(name), "%s/sample.%d", s->data, itr);
+  fd = fopen(name, "w+t+e");
+  if (!fd) {
+    printf("Cannot write %s\n", name);
+    return;
+  }
+  for (l = 0; l < s->nlines; l++) {
+    const double *line = sp->global + sp->offset[l];
+    int dir = s->line_dir[l], n = dir ? g->nx : g->ny;
+    double step = dir ? g->dx : g->dy;
+
+    fprintf(fd, "# %s = %.17g\n# %s\tu\tv\tp\n", dir ? "y" : "x",
+            s->line_pos[l], dir ? "x" : "y");
+    for (j = 0; j < n; j++) {
+      fprintf(fd, "%.8lf\t%.8lf\t%.8lf\t%.8lf\n", j * step, line[j],
+              line[n + j], line[2 * n + j]);
+    }
+    fprintf(fd, "\n");
+  }
+  fclose(fd);
+
+  if (!sp->fd) {
+    return;
+  }
+
+  /* u along x = 0.5, the first line, and v along y = 0.5, the second one */
+  for (l = 0; l < 2; l++) {
+    int n = l ? g->nx : g->ny;
+    const double *line = sp->global + sp->offset[l] + l * n;
+    double step = l ? g->dx : g->dy;
+
+    rms[l] = max[l] = 0.0;
+    for (j = 0; j < sp->npts[l]; j++) {
+      double e = interpolate(line, n, step, sp->pos[l][j] * s->l_lid) -
+                 sp->val[l][j];
+
+      rms[l] += e * e;
+      max[l] = fmax(max[l], fabs(e));
+    }
+    rms[l] = sqrt(rms[l] / (sp->npts[l] > 0 ? sp->npts[l] : 1));
+  }
+  printf("Iteration %d: Ghia et al. u rms %.3e max %.3e, v rms %.3e max "
+         "%.3e\n",
+         itr, rms[0], max[0], rms[1], max[1]);
+  fprintf(sp->fd, "%d\t%.8lf\t%.8lf\t%.8lf\t%.8lf\n", itr, rms[0], max[0],
+          rms[1], max[1]);
+  fflush(sp->fd);
+}
+
+/* Free the lines and close the log of the scores */
+void sample_free(struct Sampler *sp) {
+  free(sp->local);
+  free(sp->global);
+  if (sp->fd) {
+    fclose(sp->fd);
+  }
+}
@@ -0,0 +1,34 @@
+#include "sequence.h"
+
+/* Solve the coarse grids of a sequence one after another, each one from the
+ * fields of the one before, or of c for the first one unless they are none;
+ * c is left with the fields of the last one, which it reads from the file
+ * written when the grid converged */
+void run_sequence(struct Coarse *c, struct Grid2D *g, struct SimulationInfo *s,
+                  int rank, int nprocs) {
+  struct Member *m = (struct Member *)calloc(1, sizeof(*m));
+  char desc[sizeof(s->data) + 16];
+
+  for (int l = 0; l < s->nlevels - 1; l++) {
+    struct Grid2D gl = *g;
+    struct SimulationInfo sl = *s;
+    int state;
+
+    gl.nx = gl.ny = s->levels[l];
+    sl.tol = s->coarse_tol;
+    snprintf(sl.data, sizeof(sl.data), "data/N%d", gl.nx);
+    member_start(m, &gl, &sl, c->file[0] ? c : NULL, rank, nprocs);
+
+    do {
+      state = member_advance(m, sl.itr_max, rank);
+    } while (state == RUNNING);
+    member_finish(m, state, rank, nprocs);
+    if (state != CONVERGED) {
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+    snprintf(desc, sizeof(desc), "%s/uvp.json", sl.data);
+    read_coarse(c, desc, rank);
+  }
+  free(m);
+}
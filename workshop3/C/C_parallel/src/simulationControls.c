@@ -3,24 +3,83 @@
 /* Initialize structs */
 void initialize(struct FieldPointers *f, struct Grid2D *g,
                 struct SimulationInfo *s, int rank, int nprocs) {
+  int periods[2] = {0, 0};
+  /* Offsets of the corner neighbors: {top-left, bottom-left, bottom-right,
+   * top-right} */
+  int cx[4] = {-1, -1, 1, 1}, cy[4] = {1, -1, -1, 1};
+
+  /* Arrange the processes in a 2D Cartesian grid, keeping the ranks of
+   * MPI_COMM_WORLD so MASTER stays the same */
+  s->dims[0] = s->dims[1] = 0;
+  MPI_Dims_create(nprocs, 2, s->dims);
+  MPI_Cart_create(WORLD, 2, s->dims, periods, 0, &s->comm);
+  MPI_Cart_coords(s->comm, rank, 2, s->coords);
+
   /* set neighbors */
-  if (MASTER || LAST_NODE) {
-    g->ghosts = 1;
-  } else {
-    g->ghosts = 2;
+  MPI_Cart_shift(s->comm, 0, 1, &s->nbr[1], &s->nbr[3]);
+  MPI_Cart_shift(s->comm, 1, 1, &s->nbr[2], &s->nbr[0]);
+
+  /* Corner k lies between the sides k and k + 1 */
+  for (int k = 0; k < 4; k++) {
+    int c[2] = {s->coords[0] + cx[k], s->coords[1] + cy[k]};
+
+    s->cnbr[k] = MPI_PROC_NULL;
+    if (c[0] >= 0 && c[0] < s->dims[0] && c[1] >= 0 && c[1] < s->dims[1]) {
+      MPI_Cart_rank(s->comm, c, &s->cnbr[k]);
+    }
   }
 
-  g->nx_p = g->nx_psg = (g->nx / nprocs) + g->ghosts;
-  if (LAST_NODE){
-    g->nx_psg = g->nx_p + 1;
+  for (int k = 0; k < 16; k++) {
+    s->ureq[k] = s->vreq[k] = s->preq[k] = MPI_REQUEST_NULL;
   }
 
-  g->ubufo = array_2D(g->nx_p, g->ny + 1);
-  g->ubufn = array_2D(g->nx_p, g->ny + 1);
-  g->vbufo = array_2D(g->nx_psg, g->ny);
-  g->vbufn = array_2D(g->nx_psg, g->ny);
-  g->pbufo = array_2D(g->nx_psg, g->ny + 1);
-  g->pbufn = array_2D(g->nx_psg, g->ny + 1);
+  /* The nx + 1 (ny + 1) rows (columns) of the largest staggered field are
+   * split among the processes; u has one row less and v one column less, so
+   * the last process in each direction just leaves that one unused. Each
+   * column (row) of the Cartesian grid gets a share of them proportional to
+   * the sum of the weights of its processes. */
+  {
+    int c[2], *xs = (int *)malloc(sizeof(int) * (s->dims[0] + 1)),
+              *ys = (int *)malloc(sizeof(int) * (s->dims[1] + 1));
+    double *w = (double *)malloc(sizeof(double) * nprocs),
+           *wx = (double *)calloc(s->dims[0], sizeof(double)),
+           *wy = (double *)calloc(s->dims[1], sizeof(double));
+
+    MPI_Allgather(&s->weight, 1, MPI_DOUBLE, w, 1, MPI_DOUBLE, s->comm);
+    for (int r = 0; r < nprocs; r++) {
+      MPI_Cart_coords(s->comm, r, 2, c);
+      wx[c[0]] += w[r];
+      wy[c[1]] += w[r];
+    }
+    partition(g->nx + 1, s->dims[0], wx, xs);
+    partition(g->ny + 1, s->dims[1], wy, ys);
+    g->x0 = xs[s->coords[0]];
+    g->nx_p = xs[s->coords[0] + 1] - g->x0;
+    g->y0 = ys[s->coords[1]];
+    g->ny_p = ys[s->coords[1] + 1] - g->y0;
+    free(xs);
+    free(ys);
+    free(w);
+    free(wx);
+    free(wy);
+  }
+
+  /* Walls must be owned by the process next to them */
+  if (g->nx_p < 2 || g->ny_p < 2) {
+    if (MASTER) {
+      printf("Grid is too small for %d x %d processes.\n", s->dims[0],
+             s->dims[1]);
+    }
+    MPI_Abort(WORLD, EXIT_FAILURE);
+  }
+
+  g->stride = field_stride(g->ny_p + 2);
+  g->ubufo = field_2D(g->nx_p + 2, g->stride);
+  g->ubufn = field_2D(g->nx_p + 2, g->stride);
+  g->vbufo = field_2D(g->nx_p + 2, g->stride);
+  g->vbufn = field_2D(g->nx_p + 2, g->stride);
+  g->pbufo = field_2D(g->nx_p + 2, g->stride);
+  g->pbufn = field_2D(g->nx_p + 2, g->stride);
 
   f->u = g->ubufo;
   f->un = g->ubufn;
@@ -29,22 +88,49 @@ void initialize(struct FieldPointers *f, struct Grid2D *g,
   f->p = g->pbufo;
   f->pn = g->pbufn;
 
+  /* Interior points of each field in global indices */
+  local_range(1, g->nx - 1, g->x0, g->nx_p, &g->ur.is, &g->ur.ie);
+  local_range(1, g->ny, g->y0, g->ny_p, &g->ur.js, &g->ur.je);
+  local_range(1, g->nx, g->x0, g->nx_p, &g->vr.is, &g->vr.ie);
+  local_range(1, g->ny - 1, g->y0, g->ny_p, &g->vr.js, &g->vr.je);
+  local_range(1, g->nx, g->x0, g->nx_p, &g->pr.is, &g->pr.ie);
+  local_range(1, g->ny, g->y0, g->ny_p, &g->pr.js, &g->pr.je);
+  local_range(1, g->nx - 1, g->x0, g->nx_p, &g->er.is, &g->er.ie);
+  local_range(1, g->ny - 1, g->y0, g->ny_p, &g->er.js, &g->er.je);
+
+  MPI_Type_vector(g->nx_p, 1, g->stride, REAL_MPI, &g->col);
+  MPI_Type_commit(&g->col);
+  /* Columns sent to the top and bottom neighbors, then the ones received
+   * from the bottom and top ones */
+  g->hbuf = field_2D(4, g->nx_p);
+
   g->dx = s->l_lid / (double)(g->nx - 1);
   g->dy = s->l_lid / (double)(g->ny - 1);
 
-  /* Set c2 and cfl according to Re based on trail and error */
+  /* Set c2 and cfl according to Re based on trail and error, unless they are
+   * given */
   if (s->Re < 500.0) {
-    s->cfl = 0.15;
-    s->c2 = 5.0;
+    s->cfl = s->cfl > 0.0 ? s->cfl : 0.15;
+    s->c2 = s->c2 > 0.0 ? s->c2 : 5.0;
   } else if (s->Re < 2000 - .0) {
-    s->cfl = 0.20;
-    s->c2 = 5.8;
+    s->cfl = s->cfl > 0.0 ? s->cfl : 0.20;
+    s->c2 = s->c2 > 0.0 ? s->c2 : 5.8;
   } else {
-    s->cfl = 0.05;
-    s->c2 = 5.8;
+    s->cfl = s->cfl > 0.0 ? s->cfl : 0.05;
+    s->c2 = s->c2 > 0.0 ? s->c2 : 5.8;
   }
 
   s->nu = s->ubc[0] * s->l_lid / s->Re;
+  set_dt(g, s);
+
+#ifdef OFFLOAD
+  /* From here on the fields live on the device */
+  device_init(g, s, rank);
+#endif
+}
+
+/* Set the time step according to the CFL number */
+void set_dt(struct Grid2D *g, struct SimulationInfo *s) {
   s->dt = s->cfl * fmin(g->dx, g->dy) / s->ubc[0];
 
   /* Carry out operations that their values do not change in loops */
@@ -53,187 +139,462 @@ void initialize(struct FieldPointers *f, struct Grid2D *g,
   s->dtdxx = s->dt / (g->dx * g->dx);
   s->dtdyy = s->dt / (g->dy * g->dy);
   s->dtdxdy = s->dt * g->dx * g->dy;
+}
 
-  /* set neighbors */
-  if (MASTER) {
-    s->prev = MPI_PROC_NULL;
-  } else {
-    s->prev = rank - 1;
+/* Apply initial conditions*/
+void set_init(struct FieldPointers *f, struct Grid2D *g,
+              struct SimulationInfo *s) {
+  /* Local index of the two top rows, j = ny - 1 and j = ny */
+  int i, j, top = g->ny - g->y0 + 1, st = g->stride, ny = g->ny_p;
+  const struct Range u_r = g->ur;
+  const double lid = s->ubc[0];
+  real *restrict un = f->un;
+
+#ifdef OFFLOAD
+#pragma omp target teams distribute parallel for
+#endif
+  for (i = u_r.is; i < u_r.ie; i++) {
+    for (j = top - 1; j <= top; j++) {
+      if (j >= 1 && j <= ny) {
+        un[IDX(i, j)] = lid;
+      }
+    }
   }
+}
 
-  if (LAST_NODE) {
-    s->next = MPI_PROC_NULL;
-  } else {
-    s->next = rank + 1;
+/* Exchange the ghost layers of a field with the neighbor partitions */
+void exchange_halo(real *arr, struct Grid2D *g, struct SimulationInfo *s) {
+  int i, tag = 0, nx = g->nx_p, ny = g->ny_p, st = g->stride;
+  /* Whether there are neighbors to exchange with */
+  const int top = !TOP_WALL, bottom = !BOTTOM_WALL;
+  real *buf = g->hbuf;
+
+  TIMER_START(T_HALO);
+  /* Top and bottom: owned rows only. A column is strided, so the threads
+   * pack and unpack the rows they own instead of MPI walking it alone. */
+#pragma omp parallel for schedule(static)
+  for (i = 0; i < nx; i++) {
+    buf[i] = arr[IDX(i + 1, ny)];
+    buf[nx + i] = arr[IDX(i + 1, 1)];
+  }
+
+  MPI_Sendrecv(buf, nx, REAL_MPI, s->nbr[0], tag, buf + 2 * nx, nx,
+               REAL_MPI, s->nbr[2], tag, s->comm, MPI_STATUS_IGNORE);
+  MPI_Sendrecv(buf + nx, nx, REAL_MPI, s->nbr[2], tag, buf + 3 * nx, nx,
+               REAL_MPI, s->nbr[0], tag, s->comm, MPI_STATUS_IGNORE);
+
+#pragma omp parallel for schedule(static)
+  for (i = 0; i < nx; i++) {
+    if (bottom) {
+      arr[IDX(i + 1, 0)] = buf[2 * nx + i];
+    }
+    if (top) {
+      arr[IDX(i + 1, ny + 1)] = buf[3 * nx + i];
+    }
   }
+
+  /* Right and left: whole rows, so the corners come along */
+  MPI_Sendrecv(&arr[IDX(nx, 0)], ny + 2, REAL_MPI, s->nbr[3], tag,
+               &arr[IDX(0, 0)], ny + 2, REAL_MPI, s->nbr[1], tag, s->comm,
+               MPI_STATUS_IGNORE);
+  MPI_Sendrecv(&arr[IDX(1, 0)], ny + 2, REAL_MPI, s->nbr[1], tag,
+               &arr[IDX(nx + 1, 0)], ny + 2, REAL_MPI, s->nbr[3], tag,
+               s->comm, MPI_STATUS_IGNORE);
+  TIMER_STOP();
 }
 
-/* Apply initial conditions*/
-void set_init(struct FieldPointers *f, struct Grid2D *g,
-              struct SimulationInfo *s) {
-  for (int i = 1; i < g->nx_p - 1; i++) {
-    f->un[i][g->ny] = s->ubc[0];
-    f->un[i][g->ny - 1] = s->ubc[0];
+/* Start exchanging the ghost layers of a field with the neighbor partitions
+ * without blocking; the sides and the corners are sent at once. */
+void halo_start(real *arr, struct Grid2D *g, struct SimulationInfo *s,
+                MPI_Request *req) {
+  int k, nx = g->nx_p, ny = g->ny_p, st = g->stride;
+
+  /* Owned points sent to and ghost points received from the neighbors, in
+   * the order of s->nbr and s->cnbr */
+  real *side_send[4] = {&arr[IDX(1, ny)], &arr[IDX(1, 1)], &arr[IDX(1, 1)],
+                        &arr[IDX(nx, 1)]};
+  real *side_recv[4] = {&arr[IDX(1, ny + 1)], &arr[IDX(0, 1)],
+                        &arr[IDX(1, 0)], &arr[IDX(nx + 1, 1)]};
+  real *corner_send[4] = {&arr[IDX(1, ny)], &arr[IDX(1, 1)],
+                          &arr[IDX(nx, 1)], &arr[IDX(nx, ny)]};
+  real *corner_recv[4] = {&arr[IDX(0, ny + 1)], &arr[IDX(0, 0)],
+                          &arr[IDX(nx + 1, 0)], &arr[IDX(nx + 1, ny + 1)]};
+
+  TIMER_START(T_HALO);
+  /* Messages are tagged by the direction they travel in; the ones coming
+   * from neighbor k travel in the opposite direction, (k + 2) % 4. */
+  for (k = 0; k < 4; k++) {
+    MPI_Datatype type = (k % 2 == 0) ? g->col : REAL_MPI;
+    int n = (k % 2 == 0) ? 1 : ny;
+
+    MPI_Irecv(side_recv[k], n, type, s->nbr[k], (k + 2) % 4, s->comm,
+              &req[k]);
+    MPI_Irecv(corner_recv[k], 1, REAL_MPI, s->cnbr[k], 4 + (k + 2) % 4,
+              s->comm, &req[4 + k]);
   }
+  for (k = 0; k < 4; k++) {
+    MPI_Datatype type = (k % 2 == 0) ? g->col : REAL_MPI;
+    int n = (k % 2 == 0) ? 1 : ny;
+
+    MPI_Isend(side_send[k], n, type, s->nbr[k], k, s->comm, &req[8 + k]);
+    MPI_Isend(corner_send[k], 1, REAL_MPI, s->cnbr[k], 4 + k, s->comm,
+              &req[12 + k]);
+  }
+  TIMER_STOP();
 }
 
-/* Applying boundary conditions for velocity */
-void set_BC(struct FieldPointers *f, struct Grid2D *g, struct SimulationInfo *s,
-            int rank, int nprocs) {
-  int i, j, tag = 0;
-  MPI_Status status;
+/* Complete a halo exchange started by halo_start; completed requests are
+ * reset to MPI_REQUEST_NULL, so waiting again does nothing. */
+void halo_wait(MPI_Request *req) {
+  TIMER_START(T_HALO);
+  MPI_Waitall(16, req, MPI_STATUSES_IGNORE);
+  TIMER_STOP();
+}
 
-  /* Set virtual boundary conditions */
-  MPI_Sendrecv(&f->un[g->nx_p - 2][1], g->ny, MPI_DOUBLE, s->next, tag,
-               &f->un[g->nx_p - 1][1], g->ny, MPI_DOUBLE, s->next, tag, WORLD,
-               &status);
-  MPI_Sendrecv(&f->un[1][1], g->ny, MPI_DOUBLE, s->prev, tag, &f->un[0][1],
-               g->ny, MPI_DOUBLE, s->prev, tag, WORLD, &status);
-
-  MPI_Sendrecv(&f->vn[g->nx_psg - 2][1], g->ny - 1, MPI_DOUBLE, s->next, tag,
-               &f->vn[g->nx_psg - 1][1], g->ny - 1, MPI_DOUBLE, s->next, tag,
-               WORLD, &status);
-  MPI_Sendrecv(&f->vn[1][1], g->ny - 1, MPI_DOUBLE, s->prev, tag, &f->vn[0][1],
-               g->ny - 1, MPI_DOUBLE, s->prev, tag, WORLD, &status);
-
-  MPI_Sendrecv(&f->pn[g->nx_psg - 2][1], g->ny, MPI_DOUBLE, s->next, tag,
-               &f->pn[g->nx_psg - 1][1], g->ny, MPI_DOUBLE, s->next, tag, WORLD,
-               &status);
-  MPI_Sendrecv(&f->pn[1][1], g->ny, MPI_DOUBLE, s->prev, tag, &f->pn[0][1],
-               g->ny, MPI_DOUBLE, s->prev, tag, WORLD, &status);
-
-  /* Set physical boundary conditions */
+/* Set boundary conditions for velocity */
+void set_UBC(struct FieldPointers *f, struct Grid2D *g,
+             struct SimulationInfo *s) {
+  int i, j, st = g->stride, nx = g->nx_p, ny = g->ny_p;
+  /* Local indices of the right and top walls of u and v */
+  int ur = g->nx - g->x0, vr = g->nx_p, ut = g->ny_p, vt = g->ny_p - 1;
+  /* Walls owned by the process and their values, which the device can
+   * access */
+  const int top = TOP_WALL, left = LEFT_WALL, bottom = BOTTOM_WALL,
+            right = RIGHT_WALL;
+  const double ubc[4] = {s->ubc[0], s->ubc[1], s->ubc[2], s->ubc[3]};
+  const double vbc[4] = {s->vbc[0], s->vbc[1], s->vbc[2], s->vbc[3]};
+  real *restrict un = f->un, *restrict vn = f->vn;
+
+  TIMER_START(T_BOUNDARY);
   /* Sides */
-  if (MASTER) {
-    for (j = 0; j < g->ny; j++) {
-      f->un[0][j] = s->ubc[1];
-      f->pn[0][j] = f->pn[1][j] - g->dx * s->pbc[1];
+#ifdef OFFLOAD
+#pragma omp target teams distribute parallel for
+#endif
+  for (j = 1; j <= ny; j++) {
+    if (left) {
+      un[IDX(1, j)] = ubc[1];
+      vn[IDX(1, j)] = 2.0 * vbc[1] - vn[IDX(2, j)];
     }
-    for (j = 0; j < g->ny - 1; j++) {
-      f->vn[0][j] = 2.0 * s->vbc[1] - f->vn[1][j];
+    if (right) {
+      un[IDX(ur, j)] = ubc[3];
+      vn[IDX(vr, j)] = 2.0 * vbc[3] - vn[IDX(vr - 1, j)];
     }
   }
 
-  if (LAST_NODE) {
-    for (j = 0; j < g->ny; j++) {
-      f->un[g->nx_p - 1][j] = s->ubc[3];
-      f->pn[g->nx_psg - 1][j] = f->pn[g->nx_psg - 2][j] - g->dx * s->pbc[3];
+  /* Bottom and top */
+#ifdef OFFLOAD
+#pragma omp target teams distribute parallel for
+#endif
+  for (i = 1; i <= nx; i++) {
+    if (bottom) {
+      un[IDX(i, 1)] = 2.0 * ubc[2] - un[IDX(i, 2)];
+      vn[IDX(i, 1)] = vbc[2];
     }
-    for (j = 0; j < g->ny - 1; j++) {
-      f->vn[g->nx_psg - 1][j] = 2.0 * s->vbc[3] - f->vn[g->nx_psg - 2][j];
+    if (top) {
+      un[IDX(i, ut)] = 2.0 * ubc[0] - un[IDX(i, ut - 1)];
+      vn[IDX(i, vt)] = vbc[0];
     }
   }
 
-  /* Bottom */
-  for (i = 0; i < g->nx_p; i++){
-    f->un[i][0] = 2.0 * s->ubc[2] - f->un[i][1];
+  /* Set virtual boundary conditions */
+#ifdef OVERLAP
+  halo_start(f->un, g, s, s->ureq);
+  halo_start(f->vn, g, s, s->vreq);
+#elif defined(OFFLOAD)
+  exchange_halo_device(f->un, g, s);
+  exchange_halo_device(f->vn, g, s);
+#else
+  exchange_halo(f->un, g, s);
+  exchange_halo(f->vn, g, s);
+#endif
+  TIMER_STOP();
+}
+
+/* Set boundary conditions for pressure */
+void set_PBC(struct FieldPointers *f, struct Grid2D *g,
+             struct SimulationInfo *s) {
+  int i, j, st = g->stride, r = g->nx_p, t = g->ny_p;
+  const int top = TOP_WALL, left = LEFT_WALL, bottom = BOTTOM_WALL,
+            right = RIGHT_WALL;
+  const double pdx[4] = {g->dy * s->pbc[0], g->dx * s->pbc[1],
+                         g->dy * s->pbc[2], g->dx * s->pbc[3]};
+  real *restrict pn = f->pn;
+
+  TIMER_START(T_BOUNDARY);
+  /* Sides */
+#ifdef OFFLOAD
+#pragma omp target teams distribute parallel for
+#endif
+  for (j = 1; j <= t; j++) {
+    if (left) {
+      pn[IDX(1, j)] = pn[IDX(2, j)] - pdx[1];
+    }
+    if (right) {
+      pn[IDX(r, j)] = pn[IDX(r - 1, j)] - pdx[3];
+    }
   }
-  for (i = 0; i < g->nx_psg; i++) {
-    f->vn[i][0] = s->vbc[2];
-    f->pn[i][0] = f->pn[i][1] - g->dy * s->pbc[2];
+
+  /* Bottom and top */
+#ifdef OFFLOAD
+#pragma omp target teams distribute parallel for
+#endif
+  for (i = 1; i <= r; i++) {
+    if (bottom) {
+      pn[IDX(i, 1)] = pn[IDX(i, 2)] - pdx[2];
+    }
+    if (top) {
+      pn[IDX(i, t)] = pn[IDX(i, t - 1)] - pdx[0];
+    }
   }
 
-  /* Top */
-  for (i = 0; i < g->nx_p; i++){
-    f->un[i][g->ny] = 2.0 * s->ubc[0] - f->un[i][g->ny - 1];
+  /* Set virtual boundary conditions */
+#ifdef OVERLAP
+  halo_start(f->pn, g, s, s->preq);
+#elif defined(OFFLOAD)
+  exchange_halo_device(f->pn, g, s);
+#else
+  exchange_halo(f->pn, g, s);
+#endif
+  TIMER_STOP();
+}
+
+/* Update u and v on the given ranges of their interior points */
+static void momentum(struct FieldPointers *f, struct Grid2D *g,
+                     struct SimulationInfo *s, struct Range *ru,
+                     struct Range *rv) {
+#ifdef SIMD
+  momentum_simd(f, g, s, ru, rv);
+#else
+  int i, j, st = g->stride;
+  real *restrict un = f->un, *restrict vn = f->vn;
+  const real *restrict u = f->u, *restrict v = f->v, *restrict p = f->p;
+  /* Copies of the ranges and parameters, which the device can access */
+  const struct Range u_r = *ru, v_r = *rv;
+  const double dtdx = s->dtdx, dtdy = s->dtdy, dtdxx = s->dtdxx,
+               dtdyy = s->dtdyy, nu = s->nu;
+
+  /* v does not depend on the new u, so the threads need not wait in between */
+#ifdef OFFLOAD
+#pragma omp target teams distribute parallel for collapse(2)
+#elif defined(PERSISTENT)
+#pragma omp for private(i, j) schedule(static) nowait
+#else
+#pragma omp parallel for private(i, j) schedule(static)
+#endif
+  for (i = u_r.is; i < u_r.ie; i++) {
+    for (j = u_r.js; j < u_r.je; j++) {
+      un[IDX(i, j)] =
+          u[IDX(i, j)] -
+          0.25 * dtdx *
+              (pow(u[IDX(i + 1, j)] + u[IDX(i, j)], 2) -
+               pow(u[IDX(i, j)] + u[IDX(i - 1, j)], 2)) -
+          0.25 * dtdy *
+              ((u[IDX(i, j + 1)] + u[IDX(i, j)]) *
+                   (v[IDX(i + 1, j)] + v[IDX(i, j)]) -
+               (u[IDX(i, j)] + u[IDX(i, j - 1)]) *
+                   (v[IDX(i + 1, j - 1)] + v[IDX(i, j - 1)])) -
+          dtdx * (p[IDX(i + 1, j)] - p[IDX(i, j)]) +
+          nu * (dtdxx * (u[IDX(i + 1, j)] - 2.0 * u[IDX(i, j)] +
+                         u[IDX(i - 1, j)]) +
+                dtdyy * (u[IDX(i, j + 1)] - 2.0 * u[IDX(i, j)] +
+                         u[IDX(i, j - 1)]));
+    }
   }
-  for (i = 0; i < g->nx_psg; i++) {
-    f->vn[i][g->ny - 1] = s->vbc[0];
-    f->pn[i][g->ny] = f->pn[i][g->ny - 1] - g->dy * s->pbc[0];
+
+#ifdef OFFLOAD
+#pragma omp target teams distribute parallel for collapse(2)
+#elif defined(PERSISTENT)
+#pragma omp for private(i, j) schedule(static)
+#else
+#pragma omp parallel for private(i, j) schedule(static)
+#endif
+  for (i = v_r.is; i < v_r.ie; i++) {
+    for (j = v_r.js; j < v_r.je; j++) {
+      vn[IDX(i, j)] =
+          v[IDX(i, j)] -
+          0.25 * dtdx *
+              ((u[IDX(i, j + 1)] + u[IDX(i, j)]) *
+                   (v[IDX(i + 1, j)] + v[IDX(i, j)]) -
+               (u[IDX(i - 1, j + 1)] + u[IDX(i - 1, j)]) *
+                   (v[IDX(i, j)] + v[IDX(i - 1, j)])) -
+          0.25 * dtdy *
+              (pow(v[IDX(i, j + 1)] + v[IDX(i, j)], 2) -
+               pow(v[IDX(i, j)] + v[IDX(i, j - 1)], 2)) -
+          dtdy * (p[IDX(i, j + 1)] - p[IDX(i, j)]) +
+          nu * (dtdxx * (v[IDX(i + 1, j)] - 2.0 * v[IDX(i, j)] +
+                         v[IDX(i - 1, j)]) +
+                dtdyy * (v[IDX(i, j + 1)] - 2.0 * v[IDX(i, j)] +
+                         v[IDX(i, j - 1)]));
+    }
   }
+#endif
 }
 
 /* Solve momentum for computing u and v */
 void solve_U(struct FieldPointers *f, struct Grid2D *g,
              struct SimulationInfo *s) {
-  int i, j;
-
-#pragma omp parallel for private(i, j) schedule(auto)
-  for (i = 1; i < g->nx_p - 1; i++) {
-    for (j = 1; j < g->ny; j++) {
-      f->un[i][j] =
-          f->u[i][j] -
-          0.25 * s->dtdx *
-              (pow(f->u[i + 1][j] + f->u[i][j], 2) -
-               pow(f->u[i][j] + f->u[i - 1][j], 2)) -
-          0.25 * s->dtdy *
-              ((f->u[i][j + 1] + f->u[i][j]) * (f->v[i + 1][j] + f->v[i][j]) -
-               (f->u[i][j] + f->u[i][j - 1]) *
-                   (f->v[i + 1][j - 1] + f->v[i][j - 1])) -
-          s->dtdx * (f->p[i + 1][j] - f->p[i][j]) +
-          s->nu *
-              (s->dtdxx * (f->u[i + 1][j] - 2.0 * f->u[i][j] + f->u[i - 1][j]) +
-               s->dtdyy * (f->u[i][j + 1] - 2.0 * f->u[i][j] + f->u[i][j - 1]));
-    }
-  }
-
-#pragma omp parallel for private(i, j) schedule(auto)
-  for (i = 1; i < g->nx_psg - 1; i++) {
-    for (j = 1; j < g->ny - 1; j++) {
-      f->vn[i][j] =
-          f->v[i][j] -
-          0.25 * s->dtdx *
-              ((f->u[i][j + 1] + f->u[i][j]) * (f->v[i + 1][j] + f->v[i][j]) -
-               (f->u[i - 1][j + 1] + f->u[i - 1][j]) *
-                   (f->v[i][j] + f->v[i - 1][j])) -
-          0.25 * s->dtdy *
-              (pow(f->v[i][j + 1] + f->v[i][j], 2) -
-               pow(f->v[i][j] + f->v[i][j - 1], 2)) -
-          s->dtdy * (f->p[i][j + 1] - f->p[i][j]) +
-          s->nu *
-              (s->dtdxx * (f->v[i + 1][j] - 2.0 * f->v[i][j] + f->v[i - 1][j]) +
-               s->dtdyy * (f->v[i][j + 1] - 2.0 * f->v[i][j] + f->v[i][j - 1]));
+  TIMER_START(T_MOMENTUM);
+#ifdef OVERLAP
+  /* The last row of u and the last column of v need the pressure ghost
+   * layers, so they are left until its exchange is completed */
+  struct Range ru = g->ur, rv = g->vr;
+  struct Range ru_e = g->ur, rv_t = g->vr;
+
+  ru.ie = ru_e.is = (g->ur.ie > g->nx_p) ? g->nx_p : g->ur.ie;
+  rv.je = rv_t.js = (g->vr.je > g->ny_p) ? g->ny_p : g->vr.je;
+
+  halo_wait(s->ureq);
+  halo_wait(s->vreq);
+  momentum(f, g, s, &ru, &rv);
+
+  halo_wait(s->preq);
+  momentum(f, g, s, &ru_e, &rv_t);
+#else
+  momentum(f, g, s, &g->ur, &g->vr);
+#endif
+  TIMER_STOP();
+}
+
+/* Update p on the given range of its interior points */
+static void continuity(struct FieldPointers *f, struct Grid2D *g,
+                       struct SimulationInfo *s, struct Range *r) {
+#ifdef SIMD
+  continuity_simd(f, g, s, r);
+#else
+  int i, j, st = g->stride;
+  real *restrict pn = f->pn;
+  const real *restrict un = f->un, *restrict vn = f->vn, *restrict p = f->p;
+  const struct Range p_r = *r;
+  const double c2 = s->c2, dtdx = s->dtdx, dtdy = s->dtdy;
+
+#ifdef OFFLOAD
+#pragma omp target teams distribute parallel for collapse(2)
+#elif defined(PERSISTENT)
+#pragma omp for private(i, j) schedule(static)
+#else
+#pragma omp parallel for private(i, j) schedule(static)
+#endif
+  for (i = p_r.is; i < p_r.ie; i++) {
+    for (j = p_r.js; j < p_r.je; j++) {
+      pn[IDX(i, j)] =
+          p[IDX(i, j)] -
+          c2 * ((un[IDX(i, j)] - un[IDX(i - 1, j)]) * dtdx +
+                (vn[IDX(i, j)] - vn[IDX(i, j - 1)]) * dtdy);
     }
   }
+#endif
 }
 
 /* Solves continuity equation for computing P */
 void solve_P(struct FieldPointers *f, struct Grid2D *g,
              struct SimulationInfo *s) {
-  int i, j;
+  TIMER_START(T_CONTINUITY);
+#ifdef OVERLAP
+  /* The first row and column need the ghost layers of u and v, so they are
+   * left until their exchange is completed */
+  struct Range r = g->pr, rl = g->pr, rb = g->pr;
 
-#pragma omp parallel for private(i, j) schedule(auto)
-  for (i = 1; i < g->nx_psg - 1; i++) {
-    for (j = 1; j < g->ny; j++) {
-      f->pn[i][j] =
-          f->p[i][j] - s->c2 * ((f->un[i][j] - f->un[i - 1][j]) * s->dtdx +
-                                (f->vn[i][j] - f->vn[i][j - 1]) * s->dtdy);
-    }
-  }
+  r.is = rb.is = (g->pr.is < 2) ? 2 : g->pr.is;
+  r.js = (g->pr.js < 2) ? 2 : g->pr.js;
+  rl.ie = r.is;
+  rb.je = r.js;
+
+  continuity(f, g, s, &r);
+
+  halo_wait(s->ureq);
+  halo_wait(s->vreq);
+  continuity(f, g, s, &rl);
+  continuity(f, g, s, &rb);
+#else
+  continuity(f, g, s, &g->pr);
+#endif
+  TIMER_STOP();
 }
 
 /* Compute L2-norm */
 void l2_norm(struct FieldPointers *f, struct Grid2D *g,
-             struct SimulationInfo *s, int rank, int nprocs) {
-  int i, j;
+             struct SimulationInfo *s) {
+  int count;
+  double errs[4], sums[4];
+
+  TIMER_START(T_RESIDUAL);
+#ifdef SIMD
+  residuals_simd(f, g, s, &g->er, errs);
+#else
+  int i, j, st = g->stride;
+#ifdef PERSISTENT
+  /* A reduction in the enclosing parallel region needs shared sums */
+  static double err_u, err_v, err_p, err_d;
+#else
   double err_u = 0.0, err_v = 0.0, err_p = 0.0, err_d = 0.0;
+#endif
+  const real *restrict u = f->u, *restrict v = f->v, *restrict p = f->p;
+  const real *restrict un = f->un, *restrict vn = f->vn, *restrict pn = f->pn;
+  const struct Range e_r = g->er;
+  const double dtdx = s->dtdx, dtdy = s->dtdy;
 
-  for (i = 0; i < 5; i++){
-    s->errs[i] = 0;
-  }
-#pragma omp parallel for private(i,j) schedule(auto) \
+  /* Only the four partial sums come back from the device */
+#ifdef OFFLOAD
+#pragma omp target teams distribute parallel for collapse(2) \
+    map(tofrom: err_u, err_v, err_p, err_d)                 \
+    reduction(+:err_u, err_v, err_p, err_d)
+#elif defined(PERSISTENT)
+#pragma omp for private(i,j) schedule(static) \
+                    reduction(+:err_u, err_v, err_p, err_d)
+#else
+#pragma omp parallel for private(i,j) schedule(static) \
                              reduction(+:err_u, err_v, err_p, err_d)
-  for (i = 1; i < g->nx_p - 1; i++) {
-    for (j = 1; j < g->ny - 1; j++) {
-      err_u += pow(f->un[i][j] - f->u[i][j], 2);
-      err_v += pow(f->vn[i][j] - f->v[i][j], 2);
-      err_p += pow(f->pn[i][j] - f->p[i][j], 2);
-      err_d += (f->un[i][j] - f->un[i - 1][j]) * s->dtdx +
-               (f->vn[i][j] - f->vn[i][j - 1]) * s->dtdy;
+#endif
+  for (i = e_r.is; i < e_r.ie; i++) {
+    for (j = e_r.js; j < e_r.je; j++) {
+      double div = (un[IDX(i, j)] - un[IDX(i - 1, j)]) * dtdx +
+                   (vn[IDX(i, j)] - vn[IDX(i, j - 1)]) * dtdy;
+
+      err_u += pow(un[IDX(i, j)] - u[IDX(i, j)], 2);
+      err_v += pow(vn[IDX(i, j)] - v[IDX(i, j)], 2);
+      err_p += pow(pn[IDX(i, j)] - p[IDX(i, j)], 2);
+      err_d += div * div;
     }
   }
-  MPI_Reduce(&err_u, &s->errs[1], 1, MPI_DOUBLE, MPI_SUM, 0, WORLD);
-  MPI_Reduce(&err_v, &s->errs[2], 1, MPI_DOUBLE, MPI_SUM, 0, WORLD);
-  MPI_Reduce(&err_p, &s->errs[3], 1, MPI_DOUBLE, MPI_SUM, 0, WORLD);
-  MPI_Reduce(&err_d, &s->errs[4], 1, MPI_DOUBLE, MPI_SUM, 0, WORLD);
+#endif
+
+  /* In the enclosing parallel region, the main thread alone communicates
+   * and the others wait for the residuals; members of an ensemble call it
+   * from several threads, each for its own */
+#ifdef PERSISTENT
+#pragma omp masked
+#endif
+  {
+#ifndef SIMD
+    errs[0] = err_u;
+    errs[1] = err_v;
+    errs[2] = err_p;
+    errs[3] = err_d;
+#ifdef PERSISTENT
+    err_u = err_v = err_p = err_d = 0.0;
+#endif
+#endif
+
+    /* Sum up the partial errors of all the processes in a single
+     * collective, so every process gets the residuals and can check the
+     * convergence */
+    TIMER_START(T_ALLREDUCE);
+    MPI_Allreduce(errs, sums, 4, MPI_DOUBLE, MPI_SUM, s->comm);
+    TIMER_STOP();
 
-  if (MASTER) {
-    s->errs[1] = sqrt(s->dtdxdy * s->errs[1]);
-    s->errs[2] = sqrt(s->dtdxdy * s->errs[2]);
-    s->errs[3] = sqrt(s->dtdxdy * s->errs[3]);
-    s->errs[4] = fabs(s->errs[4]);
+    s->errs[1] = sqrt(s->dtdxdy * sums[0]);
+    s->errs[2] = sqrt(s->dtdxdy * sums[1]);
+    s->errs[3] = sqrt(s->dtdxdy * sums[2]);
+    /* The norm of the divergence, like those of u, v and p, rather than its
+     * signed sum, which is small wherever it changes sign */
+    s->errs[4] = sqrt(s->dtdxdy * sums[3]);
 
-    int count = 4;
-    s->errs[0] = fmaxof(count, s->errs[1], s->errs[2], s->errs[3], s->errs[4]);
+    count = 4;
+    s->errs[0] =
+        fmaxof(count, s->errs[1], s->errs[2], s->errs[3], s->errs[4]);
   }
+#ifdef PERSISTENT
+#pragma omp barrier
+#endif
+  TIMER_STOP();
 }
@@ -0,0 +1,234 @@
+#include "timers.h"
+
+#ifdef TIMERS
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef PAPI
+#include <papi.h>
+#endif
+
+/* Deepest nesting of the phases */
+#define T_DEPTH 8
+
+static const char *phase_names[T_PHASES] = {
+    "momentum", "continuity", "boundary", "halo",
+    "residual", "allreduce",  "output"};
+
+#ifdef PAPI
+/* Hardware counters read for each phase; the ones the CPU lacks are
+ * skipped */
+#define T_EVENTS 3
+static int event_codes[T_EVENTS] = {PAPI_TOT_CYC, PAPI_TOT_INS, PAPI_L3_TCM};
+static const char *event_names[T_EVENTS] = {"cycles", "instructions",
+                                            "L3 misses"};
+#endif
+
+/* Accumulated time and entries of each phase and the phases being in, the
+ * last one entered on top */
+static struct {
+  double start;
+  double last;
+  double time[T_PHASES];
+  long calls[T_PHASES];
+  int stack[T_DEPTH];
+  int depth;
+#ifdef PAPI
+  int set;
+  int nevents;
+  int event[T_EVENTS];
+  long long last_count[T_EVENTS];
+  long long count[T_PHASES][T_EVENTS];
+#endif
+} t;
+
+/* Only the main thread is timed within a parallel region, nested ones
+ * included */
+static int timed(void) {
+#ifdef _OPENMP
+  for (int l = omp_get_level(); l > 0; l--) {
+    if (omp_get_ancestor_thread_num(l) != 0) {
+      return 0;
+    }
+  }
+  return 1;
+#else
+  return 1;
+#endif
+}
+
+/* Charge the phase being in with the time, and counts, since the last
+ * change of phase */
+static void charge(void) {
+  double now = MPI_Wtime();
+
+  if (t.depth > 0) {
+    t.time[t.stack[t.depth - 1]] += now - t.last;
+  }
+  t.last = now;
+
+#ifdef PAPI
+  long long c[T_EVENTS];
+
+  if (t.nevents > 0 && PAPI_read(t.set, c) == PAPI_OK) {
+    for (int e = 0; e < t.nevents; e++) {
+      if (t.depth > 0) {
+        t.count[t.stack[t.depth - 1]][e] += c[e] - t.last_count[e];
+      }
+      t.last_count[e] = c[e];
+    }
+  }
+#endif
+}
+
+/* Start the clock of the whole run, and the hardware counters with PAPI */
+void timer_init(void) {
+  t.start = t.last = MPI_Wtime();
+
+#ifdef PAPI
+  /* The counters follow the main thread only */
+  t.set = PAPI_NULL;
+  if (PAPI_library_init(PAPI_VER_CURRENT) != PAPI_VER_CURRENT ||
+      PAPI_create_eventset(&t.set) != PAPI_OK) {
+    printf("PAPI is not available, no hardware counters are read\n");
+    return;
+  }
+  for (int e = 0; e < T_EVENTS; e++) {
+    if (PAPI_add_event(t.set, event_codes[e]) == PAPI_OK) {
+      t.event[t.nevents++] = e;
+    }
+  }
+  if (t.nevents > 0 && PAPI_start(t.set) == PAPI_OK) {
+    PAPI_read(t.set, t.last_count);
+  } else {
+    t.nevents = 0;
+  }
+#endif
+}
+
+/* Enter a phase */
+void timer_start(enum Phase k) {
+  if (!timed()) {
+    return;
+  }
+  charge();
+  if (t.depth < T_DEPTH) {
+    t.stack[t.depth++] = k;
+  }
+  t.calls[k]++;
+}
+
+/* Leave the phase entered last */
+void timer_stop(void) {
+  if (!timed()) {
+    return;
+  }
+  charge();
+  if (t.depth > 0) {
+    t.depth--;
+  }
+}
+
+/* Print the time per phase of each process and their min/avg/max on
+ * MASTER; all the processes must call it */
+void timer_report(int rank, int nprocs) {
+  /* Phases, the time outside of them, and the whole run */
+  const int n = T_PHASES + 2;
+  double v[T_PHASES + 2], *all = NULL;
+  int i, k;
+
+  v[n - 1] = MPI_Wtime() - t.start;
+  v[n - 2] = v[n - 1];
+  for (k = 0; k < T_PHASES; k++) {
+    v[k] = t.time[k];
+    v[n - 2] -= t.time[k];
+  }
+
+  if (rank == 0) {
+    all = (double *)malloc(sizeof(double) * n * nprocs);
+  }
+  MPI_Gather(v, n, MPI_DOUBLE, all, n, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+#ifdef PAPI
+  long long sum[T_PHASES][T_EVENTS];
+
+  MPI_Reduce(t.count, sum, T_PHASES * T_EVENTS, MPI_LONG_LONG, MPI_SUM, 0,
+             MPI_COMM_WORLD);
+#endif
+
+  if (rank != 0) {
+    return;
+  }
+
+  printf("\nTime per phase (s)\n%-10s", "");
+  for (k = 0; k < T_PHASES; k++) {
+    printf(" %11s", phase_names[k]);
+  }
+  printf(" %11s %11s\n", "other", "total");
+
+  for (i = 0; i < nprocs; i++) {
+    printf("rank %-5d", i);
+    for (k = 0; k < n; k++) {
+      printf(" %11.4e", all[i * n + k]);
+    }
+    printf("\n");
+  }
+
+  /* Load imbalance shows up as max well above avg */
+  if (nprocs > 1) {
+    double min[T_PHASES + 2], avg[T_PHASES + 2], max[T_PHASES + 2];
+
+    for (k = 0; k < n; k++) {
+      min[k] = max[k] = all[k];
+      avg[k] = 0.0;
+      for (i = 0; i < nprocs; i++) {
+        min[k] = fmin(min[k], all[i * n + k]);
+        max[k] = fmax(max[k], all[i * n + k]);
+        avg[k] += all[i * n + k] / nprocs;
+      }
+    }
+    printf("%-10s", "min");
+    for (k = 0; k < n; k++) {
+      printf(" %11.4e", min[k]);
+    }
+    printf("\n%-10s", "avg");
+    for (k = 0; k < n; k++) {
+      printf(" %11.4e", avg[k]);
+    }
+    printf("\n%-10s", "max");
+    for (k = 0; k < n; k++) {
+      printf(" %11.4e", max[k]);
+    }
+    printf("\n%-10s", "max/avg");
+    for (k = 0; k < n; k++) {
+      printf(" %11.3f", avg[k] > 0.0 ? max[k] / avg[k] : 1.0);
+    }
+    printf("\n");
+  }
+
+  printf("%-10s", "calls");
+  for (k = 0; k < T_PHASES; k++) {
+    printf(" %11ld", t.calls[k]);
+  }
+  printf("\n");
+  free(all);
+
+#ifdef PAPI
+  /* Counts summed over the processes */
+  if (t.nevents > 0) {
+    printf("\nHardware counters per phase, all processes\n%-12s", "");
+    for (int e = 0; e < t.nevents; e++) {
+      printf(" %13s", event_names[t.event[e]]);
+    }
+    printf("\n");
+    for (k = 0; k < T_PHASES; k++) {
+      printf("%-12s", phase_names[k]);
+      for (int e = 0; e < t.nevents; e++) {
+        printf(" %13lld", sum[k][e]);
+      }
+      printf("\n");
+    }
+  }
+#endif
+}
+#endif /* TIMERS */
@@ -29,9 +29,59 @@ double **array_2D(int row, int col) {
   return arr;
 }
 
+/* Find the row stride of a field with col columns; rows are padded so that
+ * each one starts on a cache line */
+int field_stride(int col) {
+  int n = ALIGN / sizeof(real);
+
+  return (col + n - 1) / n * n;
+}
+
+/* Generate a zeroed 2D field stored row by row in one aligned block. The
+ * rows are zeroed by the threads with the static schedule of the kernels, so
+ * the pages of each thread's rows are placed on its own NUMA node by first
+ * touch. */
+real *field_2D(int row, int stride) {
+  real *arr = (real *)aligned_alloc(ALIGN, sizeof(real) * row * stride);
+
+  if (!arr) {
+    printf("Memory allocation error.\n");
+    exit(EXIT_FAILURE);
+  }
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < row; i++) {
+    for (int j = 0; j < stride; j++) {
+      arr[i * stride + j] = 0.0;
+    }
+  }
+  return arr;
+}
+
+/* Free the buffers of all the fields */
+void free_fields(struct Grid2D *g) {
+#ifdef OFFLOAD
+  size_t n = (size_t)(g->nx_p + 2) * g->stride;
+
+#pragma omp target exit data map(delete: g->ubufo[0:n], g->ubufn[0:n],    \
+                                         g->vbufo[0:n], g->vbufn[0:n],    \
+                                         g->pbufo[0:n], g->pbufn[0:n],    \
+                                         g->hbuf[0:4 * g->nx_p])
+#endif
+  free(g->ubufo);
+  free(g->ubufn);
+  free(g->vbufo);
+  free(g->vbufn);
+  free(g->pbufo);
+  free(g->pbufn);
+  free(g->hbuf);
+  g->hbuf = NULL;
+  g->ubufo = g->ubufn = g->vbufo = g->vbufn = g->pbufo = g->pbufn = NULL;
+}
+
 /* Update the fields to the new time step for the next iteration */
 void update(struct FieldPointers *f) {
-  double **tmp;
+  real *tmp;
 
   tmp = f->u;
   f->u = f->un;
@@ -76,3 +126,51 @@ double fmaxof(int count, ...) {
 
   return max;
 }
+
+/* Split n points into nparts blocks with sizes proportional to the weights
+ * w; block k spans [start[k], start[k + 1]). The points left over by rounding
+ * down go one each to the blocks with the largest fractions, the first ones
+ * on a tie, so equal weights give sizes differing by one at most, the larger
+ * ones first. */
+void partition(int n, int nparts, const double *w, int *start) {
+  int k, left = n, *size = (int *)malloc(sizeof(int) * nparts);
+  double sum = 0.0, *frac = (double *)malloc(sizeof(double) * nparts);
+
+  for (k = 0; k < nparts; k++) {
+    sum += w[k];
+  }
+  for (k = 0; k < nparts; k++) {
+    double q = n * w[k] / sum;
+
+    size[k] = (int)q;
+    frac[k] = q - size[k];
+    left -= size[k];
+  }
+  while (left-- > 0) {
+    int best = 0;
+
+    for (k = 1; k < nparts; k++) {
+      best = frac[k] > frac[best] ? k : best;
+    }
+    size[best]++;
+    frac[best] = -1.0;
+  }
+
+  start[0] = 0;
+  for (k = 0; k < nparts; k++) {
+    start[k + 1] = start[k] + size[k];
+  }
+  free(size);
+  free(frac);
+}
+
+/* Find the local bounds of the global interval [lo, hi) on a block that
+ * starts at the global index start and has size points; the first owned point
+ * is at local index 1 as index 0 is the ghost layer. */
+void local_range(int lo, int hi, int start, int size, int *ls, int *le) {
+  lo = lo > start ? lo : start;
+  hi = hi < start + size ? hi : start + size;
+
+  *ls = lo - start + 1;
+  *le = hi > lo ? hi - start + 1 : *ls;
+}
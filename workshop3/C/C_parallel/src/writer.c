@@ -1,85 +1,103 @@
 #include "writer.h"
 
-/* Save fields data to files */
-void dump_data(struct Grid2D *g, struct FieldPointers *f, int rank,
-               int nprocs) {
-  int i, j, offset, inner, arr_size, count;
-  MPI_Status status;
+/* Find the global start and the local bounds of the grid points owned by
+ * the process */
+static void owned_points(struct Grid2D *g, struct Range *r, int *x0,
+                         int *y0) {
+  *x0 = g->x0;
+  *y0 = g->y0;
+  local_range(0, g->nx, g->x0, g->nx_p, &r->is, &r->ie);
+  local_range(0, g->ny, g->y0, g->ny_p, &r->js, &r->je);
+}
 
-  /* Local arrays on each process for storing fields at grid points */
-  double **ug, **vg, **pg;
+/* Write the descriptor of the binary fields file, read by
+ * plotter/uvp2txt.py */
+static void write_descriptor(struct Grid2D *g, struct SimulationInfo *s) {
+  char name[128];
+  FILE *fd;
+  const int one = 1;
 
-  inner = g->nx / nprocs;
+  snprintf(name, sizeof(name), "%s/uvp.json", s->data);
+  fd = fopen(name, "w+t+e");
+  fprintf(fd, "{\n");
+  fprintf(fd, "  \"file\": \"uvp.bin\",\n");
+  fprintf(fd, "  \"fields\": [\"u\", \"v\", \"p\"],\n");
+  fprintf(fd, "  \"dtype\": \"float64\",\n");
+  fprintf(fd, "  \"byte_order\": \"%s\",\n",
+          *(const char *)&one ? "little" : "big");
+  fprintf(fd, "  \"shape\": [%d, %d],\n", g->nx, g->ny);
+  fprintf(fd, "  \"spacing\": [%.17g, %.17g]\n", g->dx, g->dy);
+  fprintf(fd, "}\n");
+  fclose(fd);
+}
 
-  ug = array_2D(inner, g->ny);
-  vg = array_2D(inner, g->ny);
-  pg = array_2D(inner, g->ny);
+/* Save fields data to files. The fields at the grid points are stored one
+ * after another in <s->data>/uvp.bin, each as an nx x ny array of doubles in
+ * row major order; all the processes write their own blocks collectively.
+ * The fields and the communicator are freed. */
+void dump_data(struct Grid2D *g, struct FieldPointers *f,
+               struct SimulationInfo *s, int rank, int nprocs) {
+  char name[128];
+  int i, j, ni, nj, x0, y0, count, st = g->stride;
+  int sizes[2] = {g->nx, g->ny}, subsizes[2], starts[2];
+  struct Range r;
+  MPI_File fh;
+  MPI_Datatype block;
+  MPI_Offset disp = (MPI_Offset)g->nx * g->ny * sizeof(double);
 
-  offset = g->ghosts / 2;
+  /* Local arrays on each process for storing fields at grid points */
+  double **ug, **vg, **pg;
 
-  if (LAST_NODE){
-    offset = g->ghosts;
-  }
+  owned_points(g, &r, &x0, &y0);
+  ni = r.ie - r.is;
+  nj = r.je - r.js;
+
+  ug = array_2D(ni, nj);
+  vg = array_2D(ni, nj);
+  pg = array_2D(ni, nj);
 
   /* #pragma omp parallel for private(i, j) schedule(auto) */
-  for (i = 0; i < inner; i++) {
-    for (j = 0; j < g->ny; j++) {
-      ug[i][j] = 0.5 * (f->u[i + offset][j + 1] + f->u[i + offset][j]);
-      vg[i][j] = 0.5 * (f->v[i + offset + 1][j] + f->v[i + offset][j]);
-      pg[i][j] = 0.25 * (f->p[i + offset][j] + f->p[i + offset + 1][j] +
-                         f->p[i + offset][j + 1] + f->p[i + offset + 1][j + 1]);
+  for (i = 0; i < ni; i++) {
+    for (j = 0; j < nj; j++) {
+      int k = i + r.is, l = j + r.js;
+
+      ug[i][j] = 0.5 * (f->u[IDX(k, l + 1)] + f->u[IDX(k, l)]);
+      vg[i][j] = 0.5 * (f->v[IDX(k + 1, l)] + f->v[IDX(k, l)]);
+      pg[i][j] = 0.25 * (f->p[IDX(k, l)] + f->p[IDX(k + 1, l)] +
+                         f->p[IDX(k, l + 1)] + f->p[IDX(k + 1, l + 1)]);
     }
   }
 
-  arr_size = g->ny * inner;
-  if (!MASTER) {
-    MPI_Send(&(ug[0][0]), arr_size, MPI_DOUBLE, 0, 0, WORLD);
-    MPI_Send(&(vg[0][0]), arr_size, MPI_DOUBLE, 0, 0, WORLD);
-    MPI_Send(&(pg[0][0]), arr_size, MPI_DOUBLE, 0, 0, WORLD);
-
-    /* Free the memory */
-    count = 3;
-    freeMem(count, ug, vg, pg);
-  } else {
-    FILE *fd;
-    /* Buffer array on MASTER to get fields values from other processors */
-    double **ubuff, **vbuff, **pbuff;
+  free_fields(g);
 
-    ubuff = array_2D(inner, g->ny);
-    vbuff = array_2D(inner, g->ny);
-    pbuff = array_2D(inner, g->ny);
+  /* Block of the process in the global arrays */
+  subsizes[0] = ni;
+  subsizes[1] = nj;
+  starts[0] = x0;
+  starts[1] = y0;
+  MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+                           MPI_DOUBLE, &block);
+  MPI_Type_commit(&block);
 
-    fd = fopen("data/xyuvp", "w+t+e");
+  snprintf(name, sizeof(name), "%s/uvp.bin", s->data);
+  MPI_File_open(s->comm, name, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                MPI_INFO_NULL, &fh);
+  MPI_File_set_size(fh, 0);
+  MPI_File_set_view(fh, 0, MPI_DOUBLE, block, "native", MPI_INFO_NULL);
+  MPI_File_write_all(fh, &(ug[0][0]), ni * nj, MPI_DOUBLE, MPI_STATUS_IGNORE);
+  MPI_File_set_view(fh, disp, MPI_DOUBLE, block, "native", MPI_INFO_NULL);
+  MPI_File_write_all(fh, &(vg[0][0]), ni * nj, MPI_DOUBLE, MPI_STATUS_IGNORE);
+  MPI_File_set_view(fh, 2 * disp, MPI_DOUBLE, block, "native", MPI_INFO_NULL);
+  MPI_File_write_all(fh, &(pg[0][0]), ni * nj, MPI_DOUBLE, MPI_STATUS_IGNORE);
+  MPI_File_close(&fh);
 
-    /* Writing the field data from MASTER */
-    fprintf(fd, "# X \t Y \t U \t V \t P\n");
-    for (i = 0; i < inner; i++) {
-      for (j = 0; j < g->ny; j++) {
-        fprintf(fd, "%.8lf \t %.8lf \t %.8lf \t %.8lf \t %.8lf\n",
-                (double)i * g->dx, (double)j * g->dy, ug[i][j], vg[i][j],
-                pg[i][j]);
-      }
-    }
-
-    count = 6;
-    freeMem(count, g->ubufo, g->vbufo, g->pbufo, g->ubufn, g->vbufn, g->pbufn);
-    /* Writing the field data from other processors */
-    for (int r = 1; r < nprocs; r++) {
-      MPI_Recv(&(ubuff[0][0]), arr_size, MPI_DOUBLE, r, 0, WORLD, &status);
-      MPI_Recv(&(vbuff[0][0]), arr_size, MPI_DOUBLE, r, 0, WORLD, &status);
-      MPI_Recv(&(pbuff[0][0]), arr_size, MPI_DOUBLE, r, 0, WORLD, &status);
-      for (i = 0; i < inner; i++) {
-        for (j = 0; j < g->ny; j++) {
-          fprintf(fd, "%.8lf \t %.8lf \t %.8lf \t %.8lf \t %.8lf\n",
-                  (double)(i + inner * r + offset) * g->dx, (double)j * g->dy,
-                  ubuff[i][j], vbuff[i][j], pbuff[i][j]);
-        }
-      }
-    }
-    count = 6;
-    freeMem(count, ubuff, vbuff, pbuff, ug, vg, pg);
-    fclose(fd);
+  if (MASTER) {
+    write_descriptor(g, s);
   }
 
-  MPI_Finalize();
+  count = 3;
+  freeMem(count, ug, vg, pg);
+  MPI_Type_free(&block);
+  MPI_Type_free(&g->col);
+  MPI_Comm_free(&s->comm);
 }
@@ -0,0 +1,25 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "globals.h"
+#include "structs.h"
+
+/* Set the grid size and the case parameters from the command line on MASTER
+ * and broadcast them:
+ * lidCavity [--nx N] [--ny N] [--nz N] [--Re Re] [--tol tol] [--itr-max N]
+ *           [--cfl cfl] [--c2 c2] [--check-itr N] [--log-itr N]
+ *           [--log-binary] [Re [check_itr]]
+ * c2 and cfl left out are set according to Re by initialize. All the
+ * processes terminate on --help or invalid arguments. */
+void read_config(int argc, char *argv[], struct Grid3D *g,
+                 struct SimulationInfo *s, int rank);
+
+#endif /* CONFIG_H */
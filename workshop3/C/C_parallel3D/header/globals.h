@@ -0,0 +1,42 @@
+#ifndef GLOBALS_H
+#define GLOBALS_H
+
+/* Default number of grid points in x, y and z directions */
+#define IX 64
+#define IY 64
+#define IZ 64
+
+/* Fields are aligned to, and their rows padded to a multiple of, a cache line
+ * (in bytes) */
+#define ALIGN 64
+
+/* Points in y and z of the tiles the kernels are blocked in; each tile is
+ * swept through along x, so the planes of the stencil stay in cache */
+#ifndef TILE_J
+#define TILE_J 16
+#endif
+#ifndef TILE_K
+#define TILE_K 256
+#endif
+
+/* Index of the point (i, j, k) of a field; the row and plane strides of the
+ * fields must be in scope as st and sp */
+#define IDX(i, j, k) ((i) * sp + (j) * st + (k))
+
+/* Type of the values stored in the fields, and its MPI datatype */
+typedef double real;
+#define REAL_MPI MPI_DOUBLE
+
+/* MPI variables */
+#define MASTER (rank == 0)
+#define NODE (rank != 0)
+#define WORLD MPI_COMM_WORLD
+
+/* Sides of the domain, the lower and upper one of each direction, in the
+ * order of the boundary conditions and the neighbor partitions */
+enum Side { LEFT, RIGHT, BOTTOM, TOP, BACK, FRONT, SIDES };
+
+/* Physical boundaries owned by a process */
+#define WALL(side) (s->nbr[side] == MPI_PROC_NULL)
+
+#endif /* GLOBALS_H */
@@ -0,0 +1,51 @@
+#ifndef SIMULATIONCONTROLS_H
+#define SIMULATIONCONTROLS_H
+
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "globals.h"
+#include "structs.h"
+#include "timers.h"
+#include "utilities.h"
+
+/* Initialize structs */
+void initialize(struct FieldPointers *f, struct Grid3D *g,
+                struct SimulationInfo *s, int rank, int nprocs);
+
+/* Set the time step according to the CFL number */
+void set_dt(struct Grid3D *g, struct SimulationInfo *s);
+
+/* Set initial condition */
+void set_init(struct FieldPointers *f, struct Grid3D *g,
+              struct SimulationInfo *s);
+
+/* Exchange the ghost layers of a field with the neighbor partitions */
+void exchange_halo(real *arr, struct Grid3D *g, struct SimulationInfo *s);
+
+/* Applying boundary conditions for velocity */
+void set_UBC(struct FieldPointers *f, struct Grid3D *g,
+             struct SimulationInfo *s);
+
+/* Applying boundary conditions for pressure */
+void set_PBC(struct FieldPointers *f, struct Grid3D *g,
+             struct SimulationInfo *s);
+
+/* Solve momentum for computing u, v and w */
+void solve_U(struct FieldPointers *f, struct Grid3D *g,
+             struct SimulationInfo *s);
+
+/* Solves continuity equation for computing P */
+void solve_P(struct FieldPointers *f, struct Grid3D *g,
+             struct SimulationInfo *s);
+
+/* Compute L2-norm; the divergence residual is the norm of the divergence */
+void l2_norm(struct FieldPointers *f, struct Grid3D *g,
+             struct SimulationInfo *s);
+
+#endif /* SIMULATIONCONTROLS_H */
@@ -0,0 +1,141 @@
+#ifndef STRUCTS_H
+#define STRUCTS_H
+
+#include <mpi.h>
+
+#include "globals.h"
+
+/* Local index bounds, [is, ie) x [js, je) x [ks, ke), of the points updated
+ * by a loop */
+struct Range {
+  int is;
+  int ie;
+  int js;
+  int je;
+  int ks;
+  int ke;
+};
+
+struct Grid3D {
+  /* Two arrays are required for each Variable; one for old time step and one
+   * for the new time step. Each one is a single aligned block, stored plane
+   * by plane and row by row with the strides below. */
+  real *ubufo;
+  real *ubufn;
+  real *vbufo;
+  real *vbufn;
+  real *wbufo;
+  real *wbufn;
+  real *pbufo;
+  real *pbufn;
+
+  /* Number of grid points */
+  int nx;
+  int ny;
+  int nz;
+
+  /* Grid Spacing */
+  double dx;
+  double dy;
+  double dz;
+
+  /* Global index of the first point owned by a process in each direction */
+  int x0;
+  int y0;
+  int z0;
+  /* Number of points owned by a process in each direction; all the local
+   * arrays have one extra ghost layer on each side, i.e.
+   * (nx_p + 2) x (ny_p + 2) x (nz_p + 2). */
+  int nx_p;
+  int ny_p;
+  int nz_p;
+
+  /* Local bounds of the interior points of u, v, w and p and of the points
+   * contributing to the residuals */
+  struct Range ur;
+  struct Range vr;
+  struct Range wr;
+  struct Range pr;
+  struct Range er;
+
+  /* Distance between two consecutive rows (fixed i and j) and planes (fixed
+   * i) of a field */
+  int stride;
+  int plane;
+
+  /* Datatypes for exchanging a layer normal to x, y and z; each one takes in
+   * the ghost layers of the directions exchanged before it, so the edges and
+   * corners come along */
+  MPI_Datatype face[3];
+};
+
+struct FieldPointers {
+  /* Pointers to the generated buffer arrays for each variable */
+  real *u;
+  real *un;
+  real *v;
+  real *vn;
+  real *w;
+  real *wn;
+  real *p;
+  real *pn;
+};
+
+struct SimulationInfo {
+  /* Reynolds number and length of the lid */
+  double Re;
+  double l_lid;
+
+  /* Boundary conditions: {left, right, bottom, top, back, front} */
+  double ubc[SIDES];
+  double vbc[SIDES];
+  double wbc[SIDES];
+  double pbc[SIDES];
+
+  /* Flow parameters based on inputs */
+  double dt;
+  double nu;
+  double c2;
+  double cfl;
+
+  double dtdx;
+  double dtdy;
+  double dtdz;
+  double dtdxx;
+  double dtdyy;
+  double dtdzz;
+  double dtdxdydz;
+
+  /* Errors: {total, u err, v err, w err, p err, div U} */
+  double errs[6];
+  /* Number of iterations between two residual checks */
+  int check_itr;
+
+  /* Convergence tolerance and maximum number of iterations */
+  double tol;
+  int itr_max;
+
+  /* Number of iterations between two logged residuals and whether they are
+   * logged in binary */
+  int log_itr;
+  int log_binary;
+
+  /* Directory the output files are written to */
+  char data[64];
+
+  /* Cartesian communicator, its dimensions and coordinates of the process */
+  MPI_Comm comm;
+  int dims[3];
+  int coords[3];
+
+  /* Neighbor partitions: {left, right, bottom, top, back, front},
+   * MPI_PROC_NULL on the physical boundaries */
+  int nbr[SIDES];
+};
+
+/* Grid, fields and case of the run, defined in lidCavity.c */
+extern struct Grid3D g;
+extern struct FieldPointers f;
+extern struct SimulationInfo s;
+
+#endif /* STRUCTS_H */
@@ -0,0 +1,36 @@
+#ifndef UTILITITES_H
+#define UTILITITES_H
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "globals.h"
+#include "structs.h"
+
+/* Find the row stride of a field with col points in z */
+int field_stride(int col);
+
+/* Generate a zeroed 3D field of planes of row x stride points, stored plane
+ * by plane in one aligned block */
+real *field_3D(int plane, int row, int stride);
+
+/* Free the buffers of all the fields */
+void free_fields(struct Grid3D *g);
+
+/* Update the fields to the new time step for the next iteration */
+void update(struct FieldPointers *f);
+
+/* Find mamximum of a set of float numebrs */
+double fmaxof(int count, ...);
+
+/* Split n points into nparts blocks of sizes differing by one at most, the
+ * larger ones first; block k spans [start[k], start[k + 1]) */
+void partition(int n, int nparts, int *start);
+
+/* Find the local bounds of the global interval [lo, hi) on a block that
+ * starts at the global index start and has size points */
+void local_range(int lo, int hi, int start, int size, int *ls, int *le);
+
+#endif /* UTILITITES_H */
@@ -0,0 +1,17 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "globals.h"
+#include "structs.h"
+#include "utilities.h"
+
+/* Save fields data to <s->data>/uvp.bin, described by <s->data>/uvp.json,
+ * and free the fields and the communicator */
+void dump_data(struct Grid3D *g, struct FieldPointers *f,
+               struct SimulationInfo *s, int rank, int nprocs);
+
+#endif /* WRITER_H */
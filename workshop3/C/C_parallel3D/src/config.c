@@ -0,0 +1,200 @@
+#include "config.h"
+
+/* Print the usage */
+static void usage(const char *name, FILE *fd) {
+  fprintf(fd,
+          "Usage: %s [OPTION]... [Re [check_itr]]\n"
+          "options:\n"
+          "  --nx <int>         Number of grid points in x (default %d)\n"
+          "  --ny <int>         Number of grid points in y (default %d)\n"
+          "  --nz <int>         Number of grid points in z (default %d)\n"
+          "  --Re <float>       Reynolds number (default 100)\n"
+          "  --tol <float>      Convergence tolerance (default 1e-6)\n"
+          "  --itr-max <int>    Maximum number of iterations (default "
+          "1000000)\n"
+          "  --cfl <float>      CFL number (default based on Re)\n"
+          "  --c2 <float>       Artificial sound speed squared (default based "
+          "on Re)\n"
+          "  --check-itr <int>  Iterations between residual checks (default "
+          "1)\n"
+          "  --log-itr <int>    Iterations between logged residuals (default "
+          "1)\n"
+          "  --log-binary       Log the residuals in binary to "
+          "data/residual.bin\n"
+          "  -h, --help         Print the usage\n",
+          name, IX, IY, IZ);
+}
+
+/* Parse a number that must be positive; returns 0 if it is not */
+static int positive(const char *opt, const char *arg, double *x) {
+  char *ptr;
+
+  *x = strtod(arg, &ptr);
+  if (ptr == arg || *ptr != '\0' || !(*x > 0.0)) {
+    fprintf(stderr, "Invalid value '%s' for %s\n", arg, opt);
+    return 0;
+  }
+  return 1;
+}
+
+/* Parse a whole number that must be positive and fit in an int; returns 0 if
+ * it does not */
+static int positive_int(const char *opt, const char *arg, int *n) {
+  char *ptr;
+  long x;
+
+  errno = 0;
+  x = strtol(arg, &ptr, 10);
+  if (ptr == arg || *ptr != '\0' || errno == ERANGE || x < 1 ||
+      x > INT_MAX) {
+    fprintf(stderr, "Invalid value '%s' for %s, expected a whole number from "
+                    "1 to %d\n",
+            arg, opt, INT_MAX);
+    return 0;
+  }
+  *n = (int)x;
+  return 1;
+}
+
+/* Parse the command line; returns -1 to go on, or the exit status */
+static int parse(int argc, char *argv[], struct Grid3D *g,
+                 struct SimulationInfo *s) {
+  int opt, k, ok = 1;
+  const char *name;
+  static const struct option options[] = {
+      {"nx", required_argument, 0, 'x'},
+      {"ny", required_argument, 0, 'y'},
+      {"nz", required_argument, 0, 'z'},
+      {"Re", required_argument, 0, 'r'},
+      {"tol", required_argument, 0, 't'},
+      {"itr-max", required_argument, 0, 'i'},
+      {"cfl", required_argument, 0, 'f'},
+      {"c2", required_argument, 0, 'c'},
+      {"check-itr", required_argument, 0, 'k'},
+      {"log-itr", required_argument, 0, 'l'},
+      {"log-binary", no_argument, 0, 'b'},
+      {"help", no_argument, 0, 'h'},
+      {0, 0, 0, 0}};
+
+  while (ok && (opt = getopt_long(argc, argv, "h", options, &k)) != -1) {
+    if (opt == 'h') {
+      usage(argv[0], stdout);
+      return EXIT_SUCCESS;
+    }
+    if (opt == '?') {
+      ok = 0;
+      break;
+    }
+    if (opt == 'b') {
+      s->log_binary = 1;
+      continue;
+    }
+
+    name = options[k].name;
+    switch (opt) {
+    case 'x':
+      ok = positive_int(name, optarg, &g->nx);
+      break;
+    case 'y':
+      ok = positive_int(name, optarg, &g->ny);
+      break;
+    case 'z':
+      ok = positive_int(name, optarg, &g->nz);
+      break;
+    case 'r':
+      ok = positive(name, optarg, &s->Re);
+      break;
+    case 't':
+      ok = positive(name, optarg, &s->tol);
+      break;
+    case 'i':
+      ok = positive_int(name, optarg, &s->itr_max);
+      break;
+    case 'f':
+      ok = positive(name, optarg, &s->cfl);
+      break;
+    case 'c':
+      ok = positive(name, optarg, &s->c2);
+      break;
+    case 'k':
+      ok = positive_int(name, optarg, &s->check_itr);
+      break;
+    case 'l':
+      ok = positive_int(name, optarg, &s->log_itr);
+      break;
+    }
+  }
+
+  /* Reynolds number and number of iterations between residual checks may
+   * also be given as arguments */
+  if (ok && optind < argc) {
+    ok = positive("Re", argv[optind++], &s->Re);
+  }
+  if (ok && optind < argc) {
+    ok = positive_int("check_itr", argv[optind++], &s->check_itr);
+  }
+
+  /* At least one interior point of each field in each direction */
+  if (ok && (g->nx < 3 || g->ny < 3 || g->nz < 3)) {
+    fprintf(stderr, "The grid needs at least 3 x 3 x 3 points\n");
+    ok = 0;
+  }
+  /* The points of a field, its rows padded to a cache line, are indexed with
+   * an int */
+  if (ok && ((double)g->nx + 2) * ((double)g->ny + 2) *
+                    ((double)g->nz + 2 + ALIGN) >
+                INT_MAX) {
+    fprintf(stderr, "The grid of %d x %d x %d points is too large\n", g->nx,
+            g->ny, g->nz);
+    ok = 0;
+  }
+  if (ok && (s->itr_max < 1 || s->check_itr < 1 || s->log_itr < 1)) {
+    fprintf(stderr, "The number of iterations must be at least 1\n");
+    ok = 0;
+  }
+
+  if (!ok) {
+    usage(argv[0], stderr);
+    return EXIT_FAILURE;
+  }
+  return -1;
+}
+
+/* Set the grid size and the case parameters from the command line on MASTER
+ * and broadcast them */
+void read_config(int argc, char *argv[], struct Grid3D *g,
+                 struct SimulationInfo *s, int rank) {
+  int status = -1;
+
+  g->nx = IX;
+  g->ny = IY;
+  g->nz = IZ;
+  s->Re = 100.0;
+  s->tol = 1.0e-6;
+  s->itr_max = 1000000;
+  s->check_itr = 1;
+  s->log_itr = 1;
+  s->log_binary = 0;
+  strcpy(s->data, "data");
+
+  if (MASTER) {
+    status = parse(argc, argv, g, s);
+  }
+  MPI_Bcast(&status, 1, MPI_INT, 0, WORLD);
+  if (status >= 0) {
+    MPI_Finalize();
+    exit(status);
+  }
+
+  MPI_Bcast(&g->nx, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&g->ny, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&g->nz, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->Re, 1, MPI_DOUBLE, 0, WORLD);
+  MPI_Bcast(&s->tol, 1, MPI_DOUBLE, 0, WORLD);
+  MPI_Bcast(&s->itr_max, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->cfl, 1, MPI_DOUBLE, 0, WORLD);
+  MPI_Bcast(&s->c2, 1, MPI_DOUBLE, 0, WORLD);
+  MPI_Bcast(&s->check_itr, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->log_itr, 1, MPI_INT, 0, WORLD);
+  MPI_Bcast(&s->log_binary, 1, MPI_INT, 0, WORLD);
+}
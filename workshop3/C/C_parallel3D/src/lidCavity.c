@@ -0,0 +1,146 @@
+/*============================================================================*\
+Solves Navier-Stokes equations for incompressible, laminar, steady flow using
+artificial compressibility method on staggered grid, in three dimensions.
+The governing equations are as follows:
+
+P_t + c^2 div[u] = 0
+u_t + u . grad[u] = - grad[P] + nu div[grad[u]]
+
+where P is p/rho and c represents artificial sound's speed.
+
+Lid-Driven Cavity case:
+Dimensions : 1x1x1 m
+Grid size  : 64 x 64 x 64
+Re number  : 100 / 1000
+Grid type  : Staggered Arakawa C
+
+Boundary Conditions: u, v, w -> Dirichlet (as shown below)
+                     p       -> Neumann (grad[p] = 0)
+                                u=1, v=0, w=0
+                             ---------------
+                            |               |
+                            |               |
+                            |   u, v, w = 0 |
+                            |  on the other |
+                            |   five walls  |
+                             ---------------
+                      y
+                      |__ x    z out of the page
+\*============================================================================*/
+#include "config.h"
+#include "residualLog.h"
+#include "simulationControls.h"
+#include "writer.h"
+
+struct Grid3D g;
+struct FieldPointers f;
+struct SimulationInfo s;
+
+int main(int argc, char *argv[]) {
+  int itr = 1, check;
+
+  /* Log of the residuals, on MASTER */
+  static struct ResidualLog flog;
+
+  int rank, nprocs, provided;
+
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+  MPI_Comm_size(WORLD, &nprocs);
+  MPI_Comm_rank(WORLD, &rank);
+
+  /* Boundary conditions: {left, right, bottom, top, back, front} */
+  s = ((struct SimulationInfo){.ubc = {0.0, 0.0, 0.0, 1.0, 0.0, 0.0},
+                               .vbc = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+                               .wbc = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+                               .pbc = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0}});
+
+  s.l_lid = 1.0;
+
+  /* Getting grid size, Reynolds number and solver settings */
+  read_config(argc, argv, &g, &s, rank);
+  if (MASTER) {
+    printf("Re number is set to %d\n", (int)s.Re);
+    printf("Grid size is set to %d x %d x %d\n", g.nx, g.ny, g.nz);
+    printf("Residuals are checked every %d iterations\n", s.check_itr);
+#ifdef _OPENMP
+    printf("Running %d processes with %d threads each\n", nprocs,
+           omp_get_max_threads());
+    if (provided < MPI_THREAD_FUNNELED) {
+      printf("Warning: MPI does not provide MPI_THREAD_FUNNELED\n");
+    }
+#endif
+
+    /* Create a log file for outputting the residuals */
+    log_open(&flog, s.data, s.log_binary, 0);
+  }
+
+  initialize(&f, &g, &s, rank, nprocs);
+  if (MASTER) {
+    printf("Processes are arranged in %d x %d x %d\n", s.dims[0], s.dims[1],
+           s.dims[2]);
+  }
+  set_init(&f, &g, &s);
+  set_UBC(&f, &g, &s);
+  set_PBC(&f, &g, &s);
+  update(&f);
+
+  /* Start the main loop */
+  TIMER_INIT();
+  do {
+    check = (itr % s.check_itr == 0);
+
+    solve_U(&f, &g, &s);
+    set_UBC(&f, &g, &s);
+    solve_P(&f, &g, &s);
+    set_PBC(&f, &g, &s);
+
+    /* All the processes get the same residuals, so they all take the same
+     * decision without any further communication */
+    if (check) {
+      l2_norm(&f, &g, &s);
+
+      /* Check if solution diverged */
+      if (isnan(s.errs[0])) {
+        break;
+      }
+    }
+
+    TIMER_START(T_OUTPUT);
+    if (check && MASTER && (itr % s.log_itr == 0 || s.errs[0] <= s.tol)) {
+      log_residuals(&flog, itr, s.errs);
+    }
+
+    /* Update the fields */
+    update(&f);
+    TIMER_STOP();
+    itr += 1;
+  } while (!(check && s.errs[0] <= s.tol) && itr < s.itr_max);
+  TIMER_REPORT(rank, nprocs);
+
+  if (isnan(s.errs[0]) || itr == s.itr_max) {
+    if (MASTER) {
+      if (isnan(s.errs[0])) {
+        printf("Solution Diverged after %d iterations!\n", itr);
+      } else {
+        printf("Maximum number of iterations, %d, exceeded\n", itr);
+      }
+      log_close(&flog);
+    }
+
+    /* Free the memory and terminate */
+    free_fields(&g);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  if (MASTER) {
+    printf("Converged after %d iterations\n", itr);
+    log_close(&flog);
+  }
+
+  /* Write output data */
+  dump_data(&g, &f, &s, rank, nprocs);
+
+  MPI_Finalize();
+  return 0;
+}
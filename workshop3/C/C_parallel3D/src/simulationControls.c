@@ -0,0 +1,545 @@
+#include "simulationControls.h"
+
+/* The kernels are blocked in tiles of TILE_J x TILE_K points in y and z,
+ * which the threads share out, and each tile is swept through along x: the
+ * planes i - 1, i and i + 1 of a tile are all a stencil reaches, so they stay
+ * in cache from one i to the next instead of being read from memory three
+ * times. The rows of a tile are contiguous, so the innermost loops still
+ * vectorize. */
+
+/* Upper bound of the tile starting at b in a range ending at e */
+#define TILE_END(b, n, e) ((b) + (n) < (e) ? (b) + (n) : (e))
+
+/* Initialize structs */
+void initialize(struct FieldPointers *f, struct Grid3D *g,
+                struct SimulationInfo *s, int rank, int nprocs) {
+  int periods[3] = {0, 0, 0};
+  /* Points of the largest staggered field in each direction */
+  const int n[3] = {g->nx + 1, g->ny + 1, g->nz + 1};
+  int start[3], size[3];
+
+  /* Arrange the processes in a 3D Cartesian grid, keeping the ranks of
+   * MPI_COMM_WORLD so MASTER stays the same */
+  s->dims[0] = s->dims[1] = s->dims[2] = 0;
+  MPI_Dims_create(nprocs, 3, s->dims);
+  MPI_Cart_create(WORLD, 3, s->dims, periods, 0, &s->comm);
+  MPI_Cart_coords(s->comm, rank, 3, s->coords);
+
+  /* set neighbors */
+  MPI_Cart_shift(s->comm, 0, 1, &s->nbr[LEFT], &s->nbr[RIGHT]);
+  MPI_Cart_shift(s->comm, 1, 1, &s->nbr[BOTTOM], &s->nbr[TOP]);
+  MPI_Cart_shift(s->comm, 2, 1, &s->nbr[BACK], &s->nbr[FRONT]);
+
+  /* The n + 1 points of the largest staggered field in each direction are
+   * split evenly among the processes; the fields with one point less in a
+   * direction leave the last one of the last process unused */
+  for (int d = 0; d < 3; d++) {
+    int *xs = (int *)malloc(sizeof(int) * (s->dims[d] + 1));
+
+    partition(n[d], s->dims[d], xs);
+    start[d] = xs[s->coords[d]];
+    size[d] = xs[s->coords[d] + 1] - start[d];
+    free(xs);
+  }
+  g->x0 = start[0];
+  g->nx_p = size[0];
+  g->y0 = start[1];
+  g->ny_p = size[1];
+  g->z0 = start[2];
+  g->nz_p = size[2];
+
+  /* Walls must be owned by the process next to them */
+  if (g->nx_p < 2 || g->ny_p < 2 || g->nz_p < 2) {
+    if (MASTER) {
+      printf("Grid is too small for %d x %d x %d processes.\n", s->dims[0],
+             s->dims[1], s->dims[2]);
+    }
+    MPI_Abort(WORLD, EXIT_FAILURE);
+  }
+
+  g->stride = field_stride(g->nz_p + 2);
+  g->plane = (g->ny_p + 2) * g->stride;
+  g->ubufo = field_3D(g->nx_p + 2, g->ny_p + 2, g->stride);
+  g->ubufn = field_3D(g->nx_p + 2, g->ny_p + 2, g->stride);
+  g->vbufo = field_3D(g->nx_p + 2, g->ny_p + 2, g->stride);
+  g->vbufn = field_3D(g->nx_p + 2, g->ny_p + 2, g->stride);
+  g->wbufo = field_3D(g->nx_p + 2, g->ny_p + 2, g->stride);
+  g->wbufn = field_3D(g->nx_p + 2, g->ny_p + 2, g->stride);
+  g->pbufo = field_3D(g->nx_p + 2, g->ny_p + 2, g->stride);
+  g->pbufn = field_3D(g->nx_p + 2, g->ny_p + 2, g->stride);
+
+  f->u = g->ubufo;
+  f->un = g->ubufn;
+  f->v = g->vbufo;
+  f->vn = g->vbufn;
+  f->w = g->wbufo;
+  f->wn = g->wbufn;
+  f->p = g->pbufo;
+  f->pn = g->pbufn;
+
+  /* Interior points of each field in global indices */
+  local_range(1, g->nx - 1, g->x0, g->nx_p, &g->ur.is, &g->ur.ie);
+  local_range(1, g->ny, g->y0, g->ny_p, &g->ur.js, &g->ur.je);
+  local_range(1, g->nz, g->z0, g->nz_p, &g->ur.ks, &g->ur.ke);
+  local_range(1, g->nx, g->x0, g->nx_p, &g->vr.is, &g->vr.ie);
+  local_range(1, g->ny - 1, g->y0, g->ny_p, &g->vr.js, &g->vr.je);
+  local_range(1, g->nz, g->z0, g->nz_p, &g->vr.ks, &g->vr.ke);
+  local_range(1, g->nx, g->x0, g->nx_p, &g->wr.is, &g->wr.ie);
+  local_range(1, g->ny, g->y0, g->ny_p, &g->wr.js, &g->wr.je);
+  local_range(1, g->nz - 1, g->z0, g->nz_p, &g->wr.ks, &g->wr.ke);
+  local_range(1, g->nx, g->x0, g->nx_p, &g->pr.is, &g->pr.ie);
+  local_range(1, g->ny, g->y0, g->ny_p, &g->pr.js, &g->pr.je);
+  local_range(1, g->nz, g->z0, g->nz_p, &g->pr.ks, &g->pr.ke);
+  local_range(1, g->nx - 1, g->x0, g->nx_p, &g->er.is, &g->er.ie);
+  local_range(1, g->ny - 1, g->y0, g->ny_p, &g->er.js, &g->er.je);
+  local_range(1, g->nz - 1, g->z0, g->nz_p, &g->er.ks, &g->er.ke);
+
+  /* Layers normal to x, y and z exchanged by exchange_halo; the ones of y
+   * and z span the ghost layers of x, and those of z the ones of y too */
+  {
+    int sizes[3] = {g->nx_p + 2, g->ny_p + 2, g->stride};
+    int subsizes[3][3] = {{1, g->ny_p, g->nz_p},
+                          {g->nx_p + 2, 1, g->nz_p},
+                          {g->nx_p + 2, g->ny_p + 2, 1}};
+    int starts[3] = {0, 0, 0};
+
+    for (int d = 0; d < 3; d++) {
+      MPI_Type_create_subarray(3, sizes, subsizes[d], starts, MPI_ORDER_C,
+                               REAL_MPI, &g->face[d]);
+      MPI_Type_commit(&g->face[d]);
+    }
+  }
+
+  g->dx = s->l_lid / (double)(g->nx - 1);
+  g->dy = s->l_lid / (double)(g->ny - 1);
+  g->dz = s->l_lid / (double)(g->nz - 1);
+
+  /* Set c2 and cfl according to Re based on trail and error, unless they are
+   * given */
+  if (s->Re < 500.0) {
+    s->cfl = s->cfl > 0.0 ? s->cfl : 0.15;
+    s->c2 = s->c2 > 0.0 ? s->c2 : 5.0;
+  } else if (s->Re < 2000 - .0) {
+    s->cfl = s->cfl > 0.0 ? s->cfl : 0.20;
+    s->c2 = s->c2 > 0.0 ? s->c2 : 5.8;
+  } else {
+    s->cfl = s->cfl > 0.0 ? s->cfl : 0.05;
+    s->c2 = s->c2 > 0.0 ? s->c2 : 5.8;
+  }
+
+  s->nu = s->ubc[TOP] * s->l_lid / s->Re;
+  set_dt(g, s);
+}
+
+/* Set the time step according to the CFL number */
+void set_dt(struct Grid3D *g, struct SimulationInfo *s) {
+  s->dt = s->cfl * fmin(g->dx, fmin(g->dy, g->dz)) / s->ubc[TOP];
+
+  /* Carry out operations that their values do not change in loops */
+  s->dtdx = s->dt / g->dx;
+  s->dtdy = s->dt / g->dy;
+  s->dtdz = s->dt / g->dz;
+  s->dtdxx = s->dt / (g->dx * g->dx);
+  s->dtdyy = s->dt / (g->dy * g->dy);
+  s->dtdzz = s->dt / (g->dz * g->dz);
+  s->dtdxdydz = s->dt * g->dx * g->dy * g->dz;
+}
+
+/* Apply initial conditions*/
+void set_init(struct FieldPointers *f, struct Grid3D *g,
+              struct SimulationInfo *s) {
+  /* Local index of the two top rows, j = ny - 1 and j = ny */
+  int i, j, k, top = g->ny - g->y0 + 1, st = g->stride, sp = g->plane;
+  const struct Range u_r = g->ur;
+  const double lid = s->ubc[TOP];
+  real *restrict un = f->un;
+
+#pragma omp parallel for private(i, j, k) schedule(static)
+  for (i = u_r.is; i < u_r.ie; i++) {
+    for (j = top - 1; j <= top; j++) {
+      if (j < 1 || j > g->ny_p) {
+        continue;
+      }
+      for (k = u_r.ks; k < u_r.ke; k++) {
+        un[IDX(i, j, k)] = lid;
+      }
+    }
+  }
+}
+
+/* Exchange the ghost layers of a field with the neighbor partitions, one
+ * direction after another. Each direction sends the ghost layers received in
+ * the ones before it along, so the edges and corners come with the faces and
+ * no diagonal neighbors are needed. */
+void exchange_halo(real *arr, struct Grid3D *g, struct SimulationInfo *s) {
+  int d, tag = 0, nx = g->nx_p, ny = g->ny_p, nz = g->nz_p;
+  int st = g->stride, sp = g->plane;
+  /* Owned layers sent to and ghost layers received from the lower and upper
+   * neighbors in each direction */
+  real *send_lo[3] = {&arr[IDX(1, 1, 1)], &arr[IDX(0, 1, 1)],
+                      &arr[IDX(0, 0, 1)]};
+  real *send_hi[3] = {&arr[IDX(nx, 1, 1)], &arr[IDX(0, ny, 1)],
+                      &arr[IDX(0, 0, nz)]};
+  real *recv_lo[3] = {&arr[IDX(0, 1, 1)], &arr[IDX(0, 0, 1)],
+                      &arr[IDX(0, 0, 0)]};
+  real *recv_hi[3] = {&arr[IDX(nx + 1, 1, 1)], &arr[IDX(0, ny + 1, 1)],
+                      &arr[IDX(0, 0, nz + 1)]};
+
+  TIMER_START(T_HALO);
+  for (d = 0; d < 3; d++) {
+    MPI_Sendrecv(send_hi[d], 1, g->face[d], s->nbr[2 * d + 1], tag,
+                 recv_lo[d], 1, g->face[d], s->nbr[2 * d], tag, s->comm,
+                 MPI_STATUS_IGNORE);
+    MPI_Sendrecv(send_lo[d], 1, g->face[d], s->nbr[2 * d], tag, recv_hi[d],
+                 1, g->face[d], s->nbr[2 * d + 1], tag, s->comm,
+                 MPI_STATUS_IGNORE);
+  }
+  TIMER_STOP();
+}
+
+/* Set the layer l normal to the direction dir of a field, on the points owned
+ * in the other two directions, to a times the layer m plus b; a wall, l being
+ * m, is just set to b */
+static void set_layer(real *arr, struct Grid3D *g, int dir, int l, int m,
+                      double a, double b) {
+  const int n[3] = {g->nx_p, g->ny_p, g->nz_p};
+  const int sd[3] = {g->plane, g->stride, 1};
+  /* The other two directions, the inner one last */
+  const int d1 = (dir == 0) ? 1 : 0, d2 = (dir == 2) ? 1 : 2;
+  const int s1 = sd[d1], s2 = sd[d2], n1 = n[d1], n2 = n[d2];
+  real *restrict to = &arr[l * sd[dir]];
+  const real *restrict from = &arr[m * sd[dir]];
+
+  if (l == m) {
+#pragma omp parallel for schedule(static)
+    for (int p = 1; p <= n1; p++) {
+      for (int q = 1; q <= n2; q++) {
+        to[p * s1 + q * s2] = b;
+      }
+    }
+    return;
+  }
+
+#pragma omp parallel for schedule(static)
+  for (int p = 1; p <= n1; p++) {
+    for (int q = 1; q <= n2; q++) {
+      to[p * s1 + q * s2] = a * from[p * s1 + q * s2] + b;
+    }
+  }
+}
+
+/* Set boundary conditions for velocity. Each wall holds the velocity
+ * component normal to it, and the other two are mirrored across it into the
+ * ghost layer, so they average to the values of the wall. */
+void set_UBC(struct FieldPointers *f, struct Grid3D *g,
+             struct SimulationInfo *s) {
+  /* Local indices of the last layers of the fields with n points, the walls,
+   * and of those with n + 1 points, the ghost layers */
+  const int nx = g->nx_p, ny = g->ny_p, nz = g->nz_p;
+
+  TIMER_START(T_BOUNDARY);
+  /* Left and right */
+  if (WALL(LEFT)) {
+    set_layer(f->un, g, 0, 1, 1, 0.0, s->ubc[LEFT]);
+    set_layer(f->vn, g, 0, 1, 2, -1.0, 2.0 * s->vbc[LEFT]);
+    set_layer(f->wn, g, 0, 1, 2, -1.0, 2.0 * s->wbc[LEFT]);
+  }
+  if (WALL(RIGHT)) {
+    set_layer(f->un, g, 0, nx - 1, nx - 1, 0.0, s->ubc[RIGHT]);
+    set_layer(f->vn, g, 0, nx, nx - 1, -1.0, 2.0 * s->vbc[RIGHT]);
+    set_layer(f->wn, g, 0, nx, nx - 1, -1.0, 2.0 * s->wbc[RIGHT]);
+  }
+
+  /* Bottom and top */
+  if (WALL(BOTTOM)) {
+    set_layer(f->un, g, 1, 1, 2, -1.0, 2.0 * s->ubc[BOTTOM]);
+    set_layer(f->vn, g, 1, 1, 1, 0.0, s->vbc[BOTTOM]);
+    set_layer(f->wn, g, 1, 1, 2, -1.0, 2.0 * s->wbc[BOTTOM]);
+  }
+  if (WALL(TOP)) {
+    set_layer(f->un, g, 1, ny, ny - 1, -1.0, 2.0 * s->ubc[TOP]);
+    set_layer(f->vn, g, 1, ny - 1, ny - 1, 0.0, s->vbc[TOP]);
+    set_layer(f->wn, g, 1, ny, ny - 1, -1.0, 2.0 * s->wbc[TOP]);
+  }
+
+  /* Back and front */
+  if (WALL(BACK)) {
+    set_layer(f->un, g, 2, 1, 2, -1.0, 2.0 * s->ubc[BACK]);
+    set_layer(f->vn, g, 2, 1, 2, -1.0, 2.0 * s->vbc[BACK]);
+    set_layer(f->wn, g, 2, 1, 1, 0.0, s->wbc[BACK]);
+  }
+  if (WALL(FRONT)) {
+    set_layer(f->un, g, 2, nz, nz - 1, -1.0, 2.0 * s->ubc[FRONT]);
+    set_layer(f->vn, g, 2, nz, nz - 1, -1.0, 2.0 * s->vbc[FRONT]);
+    set_layer(f->wn, g, 2, nz - 1, nz - 1, 0.0, s->wbc[FRONT]);
+  }
+
+  /* Set virtual boundary conditions */
+  exchange_halo(f->un, g, s);
+  exchange_halo(f->vn, g, s);
+  exchange_halo(f->wn, g, s);
+  TIMER_STOP();
+}
+
+/* Set boundary conditions for pressure */
+void set_PBC(struct FieldPointers *f, struct Grid3D *g,
+             struct SimulationInfo *s) {
+  const int nx = g->nx_p, ny = g->ny_p, nz = g->nz_p;
+
+  TIMER_START(T_BOUNDARY);
+  if (WALL(LEFT)) {
+    set_layer(f->pn, g, 0, 1, 2, 1.0, -g->dx * s->pbc[LEFT]);
+  }
+  if (WALL(RIGHT)) {
+    set_layer(f->pn, g, 0, nx, nx - 1, 1.0, -g->dx * s->pbc[RIGHT]);
+  }
+  if (WALL(BOTTOM)) {
+    set_layer(f->pn, g, 1, 1, 2, 1.0, -g->dy * s->pbc[BOTTOM]);
+  }
+  if (WALL(TOP)) {
+    set_layer(f->pn, g, 1, ny, ny - 1, 1.0, -g->dy * s->pbc[TOP]);
+  }
+  if (WALL(BACK)) {
+    set_layer(f->pn, g, 2, 1, 2, 1.0, -g->dz * s->pbc[BACK]);
+  }
+  if (WALL(FRONT)) {
+    set_layer(f->pn, g, 2, nz, nz - 1, 1.0, -g->dz * s->pbc[FRONT]);
+  }
+
+  /* Set virtual boundary conditions */
+  exchange_halo(f->pn, g, s);
+  TIMER_STOP();
+}
+
+/* Solve momentum for computing u, v and w */
+void solve_U(struct FieldPointers *f, struct Grid3D *g,
+             struct SimulationInfo *s) {
+  int i, j, k, jb, kb, st = g->stride, sp = g->plane;
+  real *restrict un = f->un, *restrict vn = f->vn, *restrict wn = f->wn;
+  const real *restrict u = f->u, *restrict v = f->v, *restrict w = f->w,
+                       *restrict p = f->p;
+  const struct Range u_r = g->ur, v_r = g->vr, w_r = g->wr;
+  const double dtdx = s->dtdx, dtdy = s->dtdy, dtdz = s->dtdz,
+               dtdxx = s->dtdxx, dtdyy = s->dtdyy, dtdzz = s->dtdzz,
+               nu = s->nu;
+
+  TIMER_START(T_MOMENTUM);
+  /* v and w do not depend on the new u, so the threads go on past each
+   * field without waiting for the others */
+#pragma omp parallel private(i, j, k, jb, kb)
+  {
+#pragma omp for collapse(2) schedule(static) nowait
+    for (jb = u_r.js; jb < u_r.je; jb += TILE_J) {
+      for (kb = u_r.ks; kb < u_r.ke; kb += TILE_K) {
+        const int je = TILE_END(jb, TILE_J, u_r.je);
+        const int ke = TILE_END(kb, TILE_K, u_r.ke);
+
+        for (i = u_r.is; i < u_r.ie; i++) {
+          for (j = jb; j < je; j++) {
+#pragma omp simd
+            for (k = kb; k < ke; k++) {
+              un[IDX(i, j, k)] =
+                  u[IDX(i, j, k)] -
+                  0.25 * dtdx *
+                      (pow(u[IDX(i + 1, j, k)] + u[IDX(i, j, k)], 2) -
+                       pow(u[IDX(i, j, k)] + u[IDX(i - 1, j, k)], 2)) -
+                  0.25 * dtdy *
+                      ((u[IDX(i, j + 1, k)] + u[IDX(i, j, k)]) *
+                           (v[IDX(i + 1, j, k)] + v[IDX(i, j, k)]) -
+                       (u[IDX(i, j, k)] + u[IDX(i, j - 1, k)]) *
+                           (v[IDX(i + 1, j - 1, k)] + v[IDX(i, j - 1, k)])) -
+                  0.25 * dtdz *
+                      ((u[IDX(i, j, k + 1)] + u[IDX(i, j, k)]) *
+                           (w[IDX(i + 1, j, k)] + w[IDX(i, j, k)]) -
+                       (u[IDX(i, j, k)] + u[IDX(i, j, k - 1)]) *
+                           (w[IDX(i + 1, j, k - 1)] + w[IDX(i, j, k - 1)])) -
+                  dtdx * (p[IDX(i + 1, j, k)] - p[IDX(i, j, k)]) +
+                  nu * (dtdxx * (u[IDX(i + 1, j, k)] - 2.0 * u[IDX(i, j, k)] +
+                                 u[IDX(i - 1, j, k)]) +
+                        dtdyy * (u[IDX(i, j + 1, k)] - 2.0 * u[IDX(i, j, k)] +
+                                 u[IDX(i, j - 1, k)]) +
+                        dtdzz * (u[IDX(i, j, k + 1)] - 2.0 * u[IDX(i, j, k)] +
+                                 u[IDX(i, j, k - 1)]));
+            }
+          }
+        }
+      }
+    }
+
+#pragma omp for collapse(2) schedule(static) nowait
+    for (jb = v_r.js; jb < v_r.je; jb += TILE_J) {
+      for (kb = v_r.ks; kb < v_r.ke; kb += TILE_K) {
+        const int je = TILE_END(jb, TILE_J, v_r.je);
+        const int ke = TILE_END(kb, TILE_K, v_r.ke);
+
+        for (i = v_r.is; i < v_r.ie; i++) {
+          for (j = jb; j < je; j++) {
+#pragma omp simd
+            for (k = kb; k < ke; k++) {
+              vn[IDX(i, j, k)] =
+                  v[IDX(i, j, k)] -
+                  0.25 * dtdx *
+                      ((u[IDX(i, j + 1, k)] + u[IDX(i, j, k)]) *
+                           (v[IDX(i + 1, j, k)] + v[IDX(i, j, k)]) -
+                       (u[IDX(i - 1, j + 1, k)] + u[IDX(i - 1, j, k)]) *
+                           (v[IDX(i, j, k)] + v[IDX(i - 1, j, k)])) -
+                  0.25 * dtdy *
+                      (pow(v[IDX(i, j + 1, k)] + v[IDX(i, j, k)], 2) -
+                       pow(v[IDX(i, j, k)] + v[IDX(i, j - 1, k)], 2)) -
+                  0.25 * dtdz *
+                      ((v[IDX(i, j, k + 1)] + v[IDX(i, j, k)]) *
+                           (w[IDX(i, j + 1, k)] + w[IDX(i, j, k)]) -
+                       (v[IDX(i, j, k)] + v[IDX(i, j, k - 1)]) *
+                           (w[IDX(i, j + 1, k - 1)] + w[IDX(i, j, k - 1)])) -
+                  dtdy * (p[IDX(i, j + 1, k)] - p[IDX(i, j, k)]) +
+                  nu * (dtdxx * (v[IDX(i + 1, j, k)] - 2.0 * v[IDX(i, j, k)] +
+                                 v[IDX(i - 1, j, k)]) +
+                        dtdyy * (v[IDX(i, j + 1, k)] - 2.0 * v[IDX(i, j, k)] +
+                                 v[IDX(i, j - 1, k)]) +
+                        dtdzz * (v[IDX(i, j, k + 1)] - 2.0 * v[IDX(i, j, k)] +
+                                 v[IDX(i, j, k - 1)]));
+            }
+          }
+        }
+      }
+    }
+
+#pragma omp for collapse(2) schedule(static)
+    for (jb = w_r.js; jb < w_r.je; jb += TILE_J) {
+      for (kb = w_r.ks; kb < w_r.ke; kb += TILE_K) {
+        const int je = TILE_END(jb, TILE_J, w_r.je);
+        const int ke = TILE_END(kb, TILE_K, w_r.ke);
+
+        for (i = w_r.is; i < w_r.ie; i++) {
+          for (j = jb; j < je; j++) {
+#pragma omp simd
+            for (k = kb; k < ke; k++) {
+              wn[IDX(i, j, k)] =
+                  w[IDX(i, j, k)] -
+                  0.25 * dtdx *
+                      ((u[IDX(i, j, k + 1)] + u[IDX(i, j, k)]) *
+                           (w[IDX(i + 1, j, k)] + w[IDX(i, j, k)]) -
+                       (u[IDX(i - 1, j, k + 1)] + u[IDX(i - 1, j, k)]) *
+                           (w[IDX(i, j, k)] + w[IDX(i - 1, j, k)])) -
+                  0.25 * dtdy *
+                      ((v[IDX(i, j, k + 1)] + v[IDX(i, j, k)]) *
+                           (w[IDX(i, j + 1, k)] + w[IDX(i, j, k)]) -
+                       (v[IDX(i, j - 1, k + 1)] + v[IDX(i, j - 1, k)]) *
+                           (w[IDX(i, j, k)] + w[IDX(i, j - 1, k)])) -
+                  0.25 * dtdz *
+                      (pow(w[IDX(i, j, k + 1)] + w[IDX(i, j, k)], 2) -
+                       pow(w[IDX(i, j, k)] + w[IDX(i, j, k - 1)], 2)) -
+                  dtdz * (p[IDX(i, j, k + 1)] - p[IDX(i, j, k)]) +
+                  nu * (dtdxx * (w[IDX(i + 1, j, k)] - 2.0 * w[IDX(i, j, k)] +
+                                 w[IDX(i - 1, j, k)]) +
+                        dtdyy * (w[IDX(i, j + 1, k)] - 2.0 * w[IDX(i, j, k)] +
+                                 w[IDX(i, j - 1, k)]) +
+                        dtdzz * (w[IDX(i, j, k + 1)] - 2.0 * w[IDX(i, j, k)] +
+                                 w[IDX(i, j, k - 1)]));
+            }
+          }
+        }
+      }
+    }
+  }
+  TIMER_STOP();
+}
+
+/* Solves continuity equation for computing P */
+void solve_P(struct FieldPointers *f, struct Grid3D *g,
+             struct SimulationInfo *s) {
+  int i, j, k, jb, kb, st = g->stride, sp = g->plane;
+  real *restrict pn = f->pn;
+  const real *restrict un = f->un, *restrict vn = f->vn, *restrict wn = f->wn,
+                       *restrict p = f->p;
+  const struct Range p_r = g->pr;
+  const double c2 = s->c2, dtdx = s->dtdx, dtdy = s->dtdy, dtdz = s->dtdz;
+
+  TIMER_START(T_CONTINUITY);
+#pragma omp parallel for collapse(2) private(i, j, k) schedule(static)
+  for (jb = p_r.js; jb < p_r.je; jb += TILE_J) {
+    for (kb = p_r.ks; kb < p_r.ke; kb += TILE_K) {
+      const int je = TILE_END(jb, TILE_J, p_r.je);
+      const int ke = TILE_END(kb, TILE_K, p_r.ke);
+
+      for (i = p_r.is; i < p_r.ie; i++) {
+        for (j = jb; j < je; j++) {
+#pragma omp simd
+          for (k = kb; k < ke; k++) {
+            pn[IDX(i, j, k)] =
+                p[IDX(i, j, k)] -
+                c2 * ((un[IDX(i, j, k)] - un[IDX(i - 1, j, k)]) * dtdx +
+                      (vn[IDX(i, j, k)] - vn[IDX(i, j - 1, k)]) * dtdy +
+                      (wn[IDX(i, j, k)] - wn[IDX(i, j, k - 1)]) * dtdz);
+          }
+        }
+      }
+    }
+  }
+  TIMER_STOP();
+}
+
+/* Compute L2-norm */
+void l2_norm(struct FieldPointers *f, struct Grid3D *g,
+             struct SimulationInfo *s) {
+  int i, j, k, jb, kb, count, st = g->stride, sp = g->plane;
+  double errs[5], sums[5];
+  double err_u = 0.0, err_v = 0.0, err_w = 0.0, err_p = 0.0, err_d = 0.0;
+  const real *restrict u = f->u, *restrict v = f->v, *restrict w = f->w,
+                       *restrict p = f->p;
+  const real *restrict un = f->un, *restrict vn = f->vn, *restrict wn = f->wn,
+                       *restrict pn = f->pn;
+  const struct Range e_r = g->er;
+  const double dtdx = s->dtdx, dtdy = s->dtdy, dtdz = s->dtdz;
+
+  TIMER_START(T_RESIDUAL);
+#pragma omp parallel for collapse(2) private(i, j, k) schedule(static) \
+    reduction(+:err_u, err_v, err_w, err_p, err_d)
+  for (jb = e_r.js; jb < e_r.je; jb += TILE_J) {
+    for (kb = e_r.ks; kb < e_r.ke; kb += TILE_K) {
+      const int je = TILE_END(jb, TILE_J, e_r.je);
+      const int ke = TILE_END(kb, TILE_K, e_r.ke);
+
+      for (i = e_r.is; i < e_r.ie; i++) {
+        for (j = jb; j < je; j++) {
+#pragma omp simd reduction(+:err_u, err_v, err_w, err_p, err_d)
+          for (k = kb; k < ke; k++) {
+            double div = (un[IDX(i, j, k)] - un[IDX(i - 1, j, k)]) * dtdx +
+                         (vn[IDX(i, j, k)] - vn[IDX(i, j - 1, k)]) * dtdy +
+                         (wn[IDX(i, j, k)] - wn[IDX(i, j, k - 1)]) * dtdz;
+
+            err_u += pow(un[IDX(i, j, k)] - u[IDX(i, j, k)], 2);
+            err_v += pow(vn[IDX(i, j, k)] - v[IDX(i, j, k)], 2);
+            err_w += pow(wn[IDX(i, j, k)] - w[IDX(i, j, k)], 2);
+            err_p += pow(pn[IDX(i, j, k)] - p[IDX(i, j, k)], 2);
+            err_d += div * div;
+          }
+        }
+      }
+    }
+  }
+  errs[0] = err_u;
+  errs[1] = err_v;
+  errs[2] = err_w;
+  errs[3] = err_p;
+  errs[4] = err_d;
+
+  /* Sum up the partial errors of all the processes in a single collective,
+   * so every process gets the residuals and can check the convergence */
+  TIMER_START(T_ALLREDUCE);
+  MPI_Allreduce(errs, sums, 5, MPI_DOUBLE, MPI_SUM, s->comm);
+  TIMER_STOP();
+
+  s->errs[1] = sqrt(s->dtdxdydz * sums[0]);
+  s->errs[2] = sqrt(s->dtdxdydz * sums[1]);
+  s->errs[3] = sqrt(s->dtdxdydz * sums[2]);
+  s->errs[4] = sqrt(s->dtdxdydz * sums[3]);
+  /* The norm of the divergence, like those of u, v, w and p, rather than its
+   * signed sum, which is small wherever it changes sign */
+  s->errs[5] = sqrt(s->dtdxdydz * sums[4]);
+
+  count = 5;
+  s->errs[0] = fmaxof(count, s->errs[1], s->errs[2], s->errs[3], s->errs[4],
+                      s->errs[5]);
+  TIMER_STOP();
+}
@@ -0,0 +1,98 @@
+#include "utilities.h"
+
+/* Find the row stride of a field with col points in z; rows are padded so
+ * that each one starts on a cache line */
+int field_stride(int col) {
+  int n = ALIGN / sizeof(real);
+
+  return (col + n - 1) / n * n;
+}
+
+/* Generate a zeroed 3D field of planes of row x stride points, stored plane
+ * by plane in one aligned block */
+real *field_3D(int plane, int row, int stride) {
+  size_t n = (size_t)row * stride;
+  real *arr = (real *)aligned_alloc(ALIGN, sizeof(real) * plane * n);
+
+  if (!arr) {
+    printf("Memory allocation error.\n");
+    exit(EXIT_FAILURE);
+  }
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < plane; i++) {
+    for (size_t j = 0; j < n; j++) {
+      arr[i * n + j] = 0.0;
+    }
+  }
+  return arr;
+}
+
+/* Free the buffers of all the fields */
+void free_fields(struct Grid3D *g) {
+  free(g->ubufo);
+  free(g->ubufn);
+  free(g->vbufo);
+  free(g->vbufn);
+  free(g->wbufo);
+  free(g->wbufn);
+  free(g->pbufo);
+  free(g->pbufn);
+  g->ubufo = g->ubufn = g->vbufo = g->vbufn = NULL;
+  g->wbufo = g->wbufn = g->pbufo = g->pbufn = NULL;
+}
+
+/* Update the fields to the new time step for the next iteration */
+void update(struct FieldPointers *f) {
+  real *tmp;
+
+  tmp = f->u;
+  f->u = f->un;
+  f->un = tmp;
+  tmp = f->v;
+  f->v = f->vn;
+  f->vn = tmp;
+  tmp = f->w;
+  f->w = f->wn;
+  f->wn = tmp;
+  tmp = f->p;
+  f->p = f->pn;
+  f->pn = tmp;
+}
+
+/* Find mamximum of a set of float numebrs */
+double fmaxof(int count, ...) {
+  va_list args;
+  double max;
+
+  va_start(args, count);
+  max = va_arg(args, double);
+
+  for (int i = 2; i <= count; i++) {
+    max = fmax(va_arg(args, double), max);
+  }
+
+  va_end(args);
+
+  return max;
+}
+
+/* Split n points into nparts blocks of sizes differing by one at most, the
+ * larger ones first; block k spans [start[k], start[k + 1]) */
+void partition(int n, int nparts, int *start) {
+  start[0] = 0;
+  for (int k = 0; k < nparts; k++) {
+    start[k + 1] = start[k] + n / nparts + (k < n % nparts);
+  }
+}
+
+/* Find the local bounds of the global interval [lo, hi) on a block that
+ * starts at the global index start and has size points; the first owned point
+ * is at local index 1 as index 0 is the ghost layer. */
+void local_range(int lo, int hi, int start, int size, int *ls, int *le) {
+  lo = lo > start ? lo : start;
+  hi = hi < start + size ? hi : start + size;
+
+  *ls = lo - start + 1;
+  *le = hi > lo ? hi - start + 1 : *ls;
+}
@@ -0,0 +1,125 @@
+#include "writer.h"
+
+/* Find the local bounds of the grid points owned by the process */
+static void owned_points(struct Grid3D *g, struct Range *r) {
+  local_range(0, g->nx, g->x0, g->nx_p, &r->is, &r->ie);
+  local_range(0, g->ny, g->y0, g->ny_p, &r->js, &r->je);
+  local_range(0, g->nz, g->z0, g->nz_p, &r->ks, &r->ke);
+}
+
+/* Write the descriptor of the binary fields file, read by
+ * plotter/uvp2txt.py */
+static void write_descriptor(struct Grid3D *g, struct SimulationInfo *s) {
+  char name[128];
+  FILE *fd;
+  const int one = 1;
+
+  snprintf(name, sizeof(name), "%s/uvp.json", s->data);
+  fd = fopen(name, "w+t+e");
+  fprintf(fd, "{\n");
+  fprintf(fd, "  \"file\": \"uvp.bin\",\n");
+  fprintf(fd, "  \"fields\": [\"u\", \"v\", \"w\", \"p\"],\n");
+  fprintf(fd, "  \"dtype\": \"float64\",\n");
+  fprintf(fd, "  \"byte_order\": \"%s\",\n",
+          *(const char *)&one ? "little" : "big");
+  fprintf(fd, "  \"shape\": [%d, %d, %d],\n", g->nx, g->ny, g->nz);
+  fprintf(fd, "  \"spacing\": [%.17g, %.17g, %.17g]\n", g->dx, g->dy,
+          g->dz);
+  fprintf(fd, "}\n");
+  fclose(fd);
+}
+
+/* Save fields data to files. The fields at the grid points are stored one
+ * after another in <s->data>/uvp.bin, each as an nx x ny x nz array of
+ * doubles in row major order; all the processes write their own blocks
+ * collectively. The fields and the communicator are freed. */
+void dump_data(struct Grid3D *g, struct FieldPointers *f,
+               struct SimulationInfo *s, int rank, int nprocs) {
+  char name[128];
+  int i, j, k, ni, nj, nk, st = g->stride, sp = g->plane;
+  int sizes[3] = {g->nx, g->ny, g->nz}, subsizes[3], starts[3];
+  size_t n;
+  struct Range r;
+  MPI_File fh;
+  MPI_Datatype block;
+  MPI_Offset disp = (MPI_Offset)g->nx * g->ny * g->nz * sizeof(double);
+
+  /* Local arrays on each process for storing fields at grid points, one
+   * after another */
+  double *uvp;
+  const real *u = f->u, *v = f->v, *w = f->w, *p = f->p;
+
+  owned_points(g, &r);
+  ni = r.ie - r.is;
+  nj = r.je - r.js;
+  nk = r.ke - r.ks;
+  n = (size_t)ni * nj * nk;
+
+  uvp = (double *)malloc(sizeof(double) * 4 * (n > 0 ? n : 1));
+  if (!uvp) {
+    printf("Memory allocation error.\n");
+    MPI_Abort(WORLD, EXIT_FAILURE);
+  }
+
+  /* Each velocity component is averaged over the four points around the
+   * grid point in the plane normal to it, and p over the eight of the cell
+   * corners */
+#pragma omp parallel for private(i, j, k) schedule(static)
+  for (i = 0; i < ni; i++) {
+    for (j = 0; j < nj; j++) {
+      for (k = 0; k < nk; k++) {
+        size_t m = ((size_t)i * nj + j) * nk + k;
+        int a = i + r.is, b = j + r.js, c = k + r.ks;
+
+        uvp[m] = 0.25 * (u[IDX(a, b, c)] + u[IDX(a, b + 1, c)] +
+                         u[IDX(a, b, c + 1)] + u[IDX(a, b + 1, c + 1)]);
+        uvp[n + m] = 0.25 * (v[IDX(a, b, c)] + v[IDX(a + 1, b, c)] +
+                             v[IDX(a, b, c + 1)] + v[IDX(a + 1, b, c + 1)]);
+        uvp[2 * n + m] =
+            0.25 * (w[IDX(a, b, c)] + w[IDX(a + 1, b, c)] +
+                    w[IDX(a, b + 1, c)] + w[IDX(a + 1, b + 1, c)]);
+        uvp[3 * n + m] =
+            0.125 * (p[IDX(a, b, c)] + p[IDX(a + 1, b, c)] +
+                     p[IDX(a, b + 1, c)] + p[IDX(a + 1, b + 1, c)] +
+                     p[IDX(a, b, c + 1)] + p[IDX(a + 1, b, c + 1)] +
+                     p[IDX(a, b + 1, c + 1)] + p[IDX(a + 1, b + 1, c + 1)]);
+      }
+    }
+  }
+
+  free_fields(g);
+
+  /* Block of the process in the global arrays */
+  subsizes[0] = ni;
+  subsizes[1] = nj;
+  subsizes[2] = nk;
+  starts[0] = g->x0;
+  starts[1] = g->y0;
+  starts[2] = g->z0;
+  MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C,
+                           MPI_DOUBLE, &block);
+  MPI_Type_commit(&block);
+
+  snprintf(name, sizeof(name), "%s/uvp.bin", s->data);
+  MPI_File_open(s->comm, name, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                MPI_INFO_NULL, &fh);
+  MPI_File_set_size(fh, 0);
+  for (int l = 0; l < 4; l++) {
+    MPI_File_set_view(fh, l * disp, MPI_DOUBLE, block, "native",
+                      MPI_INFO_NULL);
+    MPI_File_write_all(fh, uvp + l * n, (int)n, MPI_DOUBLE,
+                       MPI_STATUS_IGNORE);
+  }
+  MPI_File_close(&fh);
+
+  if (MASTER) {
+    write_descriptor(g, s);
+  }
+
+  free(uvp);
+  MPI_Type_free(&block);
+  for (int d = 0; d < 3; d++) {
+    MPI_Type_free(&g->face[d]);
+  }
+  MPI_Comm_free(&s->comm);
+}
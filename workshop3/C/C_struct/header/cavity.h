@@ -0,0 +1,72 @@
+#ifndef CAVITY_H
+#define CAVITY_H
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "config.h"
+#include "fusedSweep.h"
+#include "globals.h"
+#include "inplaceSweep.h"
+#include "multigrid.h"
+#include "simulationControls.h"
+#include "structs.h"
+#include "utilities.h"
+
+/* C API of the solver, built into lib/libcavity.so with USE_SHARED and driven
+ * by python/cavity.py. A Cavity holds a case of its own, so several of them
+ * may be set up at once. */
+
+/* State of a case after an iteration */
+enum CavityState {
+  CAVITY_RUNNING,
+  CAVITY_CONVERGED,
+  CAVITY_DIVERGED,
+  CAVITY_EXCEEDED
+};
+
+/* Fields of a case */
+enum CavityField { CAVITY_U, CAVITY_V, CAVITY_P };
+
+struct Cavity {
+  struct Grid2D g;
+  struct FieldPointers f;
+  struct SimulationInfo s;
+
+  /* Coarse grid levels, if multigrid is used */
+  struct Multigrid mg;
+
+  /* Number of the next iteration and state after the last one */
+  int itr;
+  int state;
+};
+
+/* Set up a case in *c from the options of lidCavity, argv[0] being the name
+ * of the program; returns -1 once it is set up, or the exit status of
+ * lidCavity on --help or invalid options, leaving *c NULL */
+int cavity_init(struct Cavity **c, int argc, char *argv[]);
+
+/* Carry out up to n iterations, stopping once the case is no longer running;
+ * returns its state */
+int cavity_step(struct Cavity *c, int n);
+
+/* Number of iterations carried out so far */
+int cavity_iterations(const struct Cavity *c);
+
+/* Residuals of the last iteration: {total, u, v, p, div U} */
+const double *cavity_residuals(const struct Cavity *c);
+
+/* Get the latest values of a field, a rows x cols array with its rows stride
+ * doubles apart. The buffers are swapped in each iteration, so the pointer is
+ * only valid until the next call to cavity_step. */
+double *cavity_field(struct Cavity *c, int field, int *rows, int *cols,
+                     int *stride);
+
+/* Grid size and spacing: {nx, ny}, {dx, dy} */
+void cavity_grid(const struct Cavity *c, int *n, double *d);
+
+/* Free a case */
+void cavity_free(struct Cavity *c);
+
+#endif /* CAVITY_H */
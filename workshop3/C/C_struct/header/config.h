@@ -0,0 +1,29 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "globals.h"
+#include "structs.h"
+
+/* Set the grid size and the case parameters from the command line:
+ * lidCavity [--nx N] [--ny N] [--Re Re] [--tol tol] [--itr-max N]
+ *           [--cfl cfl] [--c2 c2] [--log-itr N] [--log-binary]
+ *           [--smoothing eps] [--mg-levels N]
+ *           [--mg-cycle V|W] [--mg-pre N] [--mg-post N] [Re]
+ * c2 and cfl left out are set according to Re by initialize. Returns -1 to
+ * go on, or the exit status on --help or invalid arguments. */
+int parse_config(int argc, char *argv[], struct Grid2D *g,
+                 struct SimulationInfo *s);
+
+/* Set the grid size and the case parameters from the command line as
+ * parse_config does, terminating on --help or invalid arguments */
+void read_config(int argc, char *argv[], struct Grid2D *g,
+                 struct SimulationInfo *s);
+
+#endif /* CONFIG_H */
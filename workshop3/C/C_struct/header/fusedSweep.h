@@ -0,0 +1,20 @@
+#ifndef FUSEDSWEEP_H
+#define FUSEDSWEEP_H
+
+#include <math.h>
+
+#include "globals.h"
+#include "simulationControls.h"
+#include "structs.h"
+#include "utilities.h"
+
+#ifdef FUSED
+/* Advance u, v and p by nsteps pseudo-time steps in one pass over memory and
+ * compute the residuals of the last step. On return un, vn and pn hold the
+ * last step and u, v and p the one before it, as after solve_U, set_UBC,
+ * solve_P, set_PBC and l2_norm. */
+void solve_fused(struct FieldPointers *f, struct Grid2D *g,
+                 struct SimulationInfo *s, int nsteps);
+#endif /* FUSED */
+
+#endif /* FUSEDSWEEP_H */
@@ -1,8 +1,28 @@
 #ifndef GLOBALS_H
 #define GLOBALS_H
 
-/* Specify number of grid points in x and y directions */
+/* Default number of grid points in x and y directions; the scalar kernels
+ * have a fast path with constant loop bounds for this size */
 #define IX 128
 #define IY 128
 
+/* Fields are aligned to, and their rows padded to a multiple of, a cache line
+ * (in bytes) */
+#define ALIGN 64
+
+/* Row stride of a field with col columns */
+#define STRIDE(col) (((col) + ALIGN / 8 - 1) / (ALIGN / 8) * (ALIGN / 8))
+
+/* Index of the point (i, j) of a field; the row stride of the fields must be
+ * in scope as st */
+#define IDX(i, j) ((i) * st + (j))
+
+/* Rows and columns of a tile of the fused sweep and number of pseudo-time
+ * steps it takes in each iteration */
+#define TILE_I 16
+#define TILE_J 512
+#ifndef FUSED_STEPS
+#define FUSED_STEPS 1
+#endif
+
 #endif /* GLOBALS_H */
@@ -0,0 +1,23 @@
+#ifndef INPLACESWEEP_H
+#define INPLACESWEEP_H
+
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "globals.h"
+#include "simulationControls.h"
+#include "structs.h"
+#include "utilities.h"
+
+#ifdef INPLACE
+/* Advance u, v and p by one red-black Gauss-Seidel sweep, over the rows, of
+ * the pseudo-time steps, overwriting them in place, and compute the residuals
+ * of the sweep. The fields have a single buffer each, un, vn and pn being the
+ * same as u, v and p, so update does nothing. */
+void solve_inplace(struct FieldPointers *f, struct Grid2D *g,
+                   struct SimulationInfo *s);
+#endif /* INPLACE */
+
+#endif /* INPLACESWEEP_H */
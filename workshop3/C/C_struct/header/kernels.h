@@ -0,0 +1,112 @@
+/* Scalar kernels of solve_U, solve_P and l2_norm. simulationControls.c includes
+ * this file once per specialization; before each inclusion it defines
+ * KERNEL(name) to name the functions, and NX, NY and ST to the number of grid
+ * points and the row stride, either as constants or in terms of g. */
+
+/* Update u and v on their interior points */
+static void KERNEL(momentum)(struct FieldPointers *f, struct Grid2D *g,
+                             struct SimulationInfo *s) {
+  int i, j;
+  double *restrict un = f->un, *restrict vn = f->vn;
+  const double *restrict u = f->u, *restrict v = f->v, *restrict p = f->p;
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = 1; i < NX - 1; i++) {
+    const int st = ST;
+
+    for (j = 1; j < NY; j++) {
+      un[IDX(i, j)] =
+          u[IDX(i, j)] -
+          0.25 * s->dtdx *
+              (pow(u[IDX(i + 1, j)] + u[IDX(i, j)], 2) -
+               pow(u[IDX(i, j)] + u[IDX(i - 1, j)], 2)) -
+          0.25 * s->dtdy *
+              ((u[IDX(i, j + 1)] + u[IDX(i, j)]) *
+                   (v[IDX(i + 1, j)] + v[IDX(i, j)]) -
+               (u[IDX(i, j)] + u[IDX(i, j - 1)]) *
+                   (v[IDX(i + 1, j - 1)] + v[IDX(i, j - 1)])) -
+          s->dtdx * (p[IDX(i + 1, j)] - p[IDX(i, j)]) +
+          s->nu * (s->dtdxx * (u[IDX(i + 1, j)] - 2.0 * u[IDX(i, j)] +
+                               u[IDX(i - 1, j)]) +
+                   s->dtdyy * (u[IDX(i, j + 1)] - 2.0 * u[IDX(i, j)] +
+                               u[IDX(i, j - 1)]));
+    }
+  }
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = 1; i < NX; i++) {
+    const int st = ST;
+
+    for (j = 1; j < NY - 1; j++) {
+      vn[IDX(i, j)] =
+          v[IDX(i, j)] -
+          0.25 * s->dtdx *
+              ((u[IDX(i, j + 1)] + u[IDX(i, j)]) *
+                   (v[IDX(i + 1, j)] + v[IDX(i, j)]) -
+               (u[IDX(i - 1, j + 1)] + u[IDX(i - 1, j)]) *
+                   (v[IDX(i, j)] + v[IDX(i - 1, j)])) -
+          0.25 * s->dtdy *
+              (pow(v[IDX(i, j + 1)] + v[IDX(i, j)], 2) -
+               pow(v[IDX(i, j)] + v[IDX(i, j - 1)], 2)) -
+          s->dtdy * (p[IDX(i, j + 1)] - p[IDX(i, j)]) +
+          s->nu * (s->dtdxx * (v[IDX(i + 1, j)] - 2.0 * v[IDX(i, j)] +
+                               v[IDX(i - 1, j)]) +
+                   s->dtdyy * (v[IDX(i, j + 1)] - 2.0 * v[IDX(i, j)] +
+                               v[IDX(i, j - 1)]));
+    }
+  }
+}
+
+/* Update p on its interior points */
+static void KERNEL(continuity)(struct FieldPointers *f, struct Grid2D *g,
+                               struct SimulationInfo *s) {
+  int i, j;
+  double *restrict pn = f->pn;
+  const double *restrict un = f->un, *restrict vn = f->vn, *restrict p = f->p;
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = 1; i < NX; i++) {
+    const int st = ST;
+
+    for (j = 1; j < NY; j++) {
+      pn[IDX(i, j)] =
+          p[IDX(i, j)] -
+          s->c2 * ((un[IDX(i, j)] - un[IDX(i - 1, j)]) * s->dtdx +
+                   (vn[IDX(i, j)] - vn[IDX(i, j - 1)]) * s->dtdy);
+    }
+  }
+}
+
+/* Sum up the squared changes of u, v and p and the divergence;
+ * errs = {u err, v err, p err, div U} */
+static void KERNEL(residuals)(struct FieldPointers *f, struct Grid2D *g,
+                              struct SimulationInfo *s, double *errs) {
+  int i, j;
+  double err_u = 0.0, err_v = 0.0, err_p = 0.0, err_d = 0.0;
+  const double *restrict u = f->u, *restrict v = f->v, *restrict p = f->p;
+  const double *restrict un = f->un, *restrict vn = f->vn, *restrict pn = f->pn;
+
+#pragma omp parallel for private(i,j) schedule(auto) \
+                             reduction(+:err_u, err_v, err_p, err_d)
+  for (i = 1; i < NX - 1; i++) {
+    const int st = ST;
+
+    for (j = 1; j < NY - 1; j++) {
+      err_u += pow(un[IDX(i, j)] - u[IDX(i, j)], 2);
+      err_v += pow(vn[IDX(i, j)] - v[IDX(i, j)], 2);
+      err_p += pow(pn[IDX(i, j)] - p[IDX(i, j)], 2);
+      err_d += (un[IDX(i, j)] - un[IDX(i - 1, j)]) * s->dtdx +
+               (vn[IDX(i, j)] - vn[IDX(i, j - 1)]) * s->dtdy;
+    }
+  }
+
+  errs[0] = err_u;
+  errs[1] = err_v;
+  errs[2] = err_p;
+  errs[3] = err_d;
+}
+
+#undef KERNEL
+#undef NX
+#undef NY
+#undef ST
@@ -0,0 +1,54 @@
+#ifndef MULTIGRID_H
+#define MULTIGRID_H
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "globals.h"
+#include "simulationControls.h"
+#include "structs.h"
+#include "utilities.h"
+
+/* Maximum number of grid levels of the multigrid cycles */
+#define MG_LEVELS 16
+
+/* A grid level of the multigrid cycles. The finest level works on the fields
+ * of the solver, so only the coarser ones use g, f and s. */
+struct MGLevel {
+  struct Grid2D g;
+  struct FieldPointers f;
+  struct SimulationInfo s;
+
+  /* State restricted from the finer level, then the change from it */
+  double *u0;
+  double *v0;
+  double *p0;
+
+  /* Source terms of the coarse grid equations, as rates; NULL on the finest
+   * level */
+  double *su;
+  double *sv;
+  double *sp;
+};
+
+struct Multigrid {
+  int nlevels;
+  struct MGLevel lv[MG_LEVELS];
+};
+
+/* Set up the coarser levels of the grid g, up to s->mg_levels levels in all;
+ * each one halves the number of p cells in both directions */
+void mg_init(struct Multigrid *mg, struct Grid2D *g, struct SimulationInfo *s);
+
+/* Carry out one multigrid cycle from the fields u, v and p. As an iteration of
+ * the single grid solver, it leaves the new fields in un, vn and pn, their
+ * boundary conditions applied, and the residuals in s->errs. */
+void mg_cycle(struct Multigrid *mg, struct FieldPointers *f, struct Grid2D *g,
+              struct SimulationInfo *s);
+
+/* Free the coarser levels */
+void mg_free(struct Multigrid *mg);
+
+#endif /* MULTIGRID_H */
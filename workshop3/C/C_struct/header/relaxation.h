@@ -0,0 +1,21 @@
+#ifndef RELAXATION_H
+#define RELAXATION_H
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "globals.h"
+#include "structs.h"
+#include "timers.h"
+#include "utilities.h"
+
+/* Smooth the changes of u and v implicitly */
+void relax_U(struct FieldPointers *f, struct Grid2D *g,
+             struct SimulationInfo *s);
+
+/* Smooth the changes of p implicitly */
+void relax_P(struct FieldPointers *f, struct Grid2D *g,
+             struct SimulationInfo *s);
+
+#endif /* RELAXATION_H */
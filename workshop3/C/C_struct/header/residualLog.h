@@ -0,0 +1,32 @@
+#ifndef RESIDUALLOG_H
+#define RESIDUALLOG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Number of records kept in memory before they are written out */
+#define LOG_RECORDS 1024
+
+/* Residual log: the records {iteration, total, u, v, p, divergence} are
+ * buffered and written in blocks, either as text to data/residual or as raw
+ * doubles, six per record, to data/residual.bin */
+struct ResidualLog {
+  FILE *fd;
+  int binary;
+  int count;
+  double records[LOG_RECORDS][6];
+};
+
+/* Open the log file; append to it when resuming a run */
+void log_open(struct ResidualLog *log, int binary, int append);
+
+/* Add the residuals of an iteration to the log */
+void log_residuals(struct ResidualLog *log, int itr, double *errs);
+
+/* Write out the buffered records */
+void log_flush(struct ResidualLog *log);
+
+/* Write out the buffered records and close the log file */
+void log_close(struct ResidualLog *log);
+
+#endif /* RESIDUALLOG_H */
@@ -4,9 +4,15 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "globals.h"
+#include "relaxation.h"
+#include "simd.h"
 #include "structs.h"
+#include "timers.h"
 #include "utilities.h"
 
 /* Applying boundary conditions for velocity */
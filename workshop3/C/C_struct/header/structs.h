@@ -3,13 +3,15 @@
 
 struct Grid2D {
   /* Two arrays are required for each Variable; one for old time step and one
-   * for the new time step. */
-  double **ubufo;
-  double **ubufn;
-  double **vbufo;
-  double **vbufn;
-  double **pbufo;
-  double **pbufn;
+   * for the new time step, but the in-place sweep, which only has the old
+   * ones. Each one is a single aligned block, stored row by row with the row
+   * stride below. */
+  double *ubufo;
+  double *ubufn;
+  double *vbufo;
+  double *vbufn;
+  double *pbufo;
+  double *pbufn;
 
   /* Number of grid points */
   int nx;
@@ -18,16 +20,24 @@ struct Grid2D {
   /* Grid Spacing */
   double dx;
   double dy;
+
+  /* Distance between two consecutive rows of a field */
+  int stride;
+
+  /* Scratch rows of the in-place sweep, one per thread, and their number;
+   * none otherwise */
+  double *rows;
+  int nrows;
 } g;
 
 struct FieldPointers {
   /* Pointers to the generated buffer arrays for each variable */
-  double **u;
-  double **un;
-  double **v;
-  double **vn;
-  double **p;
-  double **pn;
+  double *u;
+  double *un;
+  double *v;
+  double *vn;
+  double *p;
+  double *pn;
 } f;
 
 struct SimulationInfo {
@@ -54,6 +64,25 @@ struct SimulationInfo {
 
   /* Errors: {total, u err, v err, p err, div U} */
   double errs[5];
+
+  /* Convergence tolerance and maximum number of iterations */
+  double tol;
+  int itr_max;
+
+  /* Number of iterations between two logged residuals and whether they are
+   * logged in binary */
+  int log_itr;
+  int log_binary;
+
+  /* Coefficient of the implicit residual smoothing, none if 0 */
+  double irs;
+
+  /* Number of multigrid levels, 1 for none, number of coarse grid cycles in
+   * each cycle, 1 for V and 2 for W, and iterations before and after them */
+  int mg_levels;
+  int mg_gamma;
+  int mg_pre;
+  int mg_post;
 } s;
 
 #endif /* STRUCTS_H */
@@ -0,0 +1,47 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Phases of an iteration timed with TIMERS; a phase started within another
+ * one pauses it, so each time is exclusive */
+enum Phase {
+  T_MOMENTUM,
+  T_CONTINUITY,
+  T_RELAX,
+  T_BOUNDARY,
+  T_RESIDUAL,
+  T_MULTIGRID,
+  T_FUSED,
+  T_INPLACE,
+  T_OUTPUT,
+  T_PHASES
+};
+
+#ifdef TIMERS
+#define TIMER_INIT() timer_init()
+#define TIMER_START(k) timer_start(k)
+#define TIMER_STOP() timer_stop()
+#define TIMER_REPORT() timer_report()
+
+/* Start the clock of the whole run, and the hardware counters with PAPI */
+void timer_init(void);
+
+/* Enter a phase */
+void timer_start(enum Phase k);
+
+/* Leave the phase entered last */
+void timer_stop(void);
+
+/* Print the time per phase */
+void timer_report(void);
+#else
+#define TIMER_INIT()
+#define TIMER_START(k)
+#define TIMER_STOP()
+#define TIMER_REPORT()
+#endif /* TIMERS */
+
+#endif /* TIMERS_H */
@@ -6,11 +6,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "globals.h"
 #include "structs.h"
 
 /* Generate a 2D array using pointer to pointer */
 double **array_2D(int row, int col);
 
+/* Find the row stride of a field with col columns */
+int field_stride(int col);
+
+/* Generate a zeroed 2D field stored row by row in one aligned block */
+double *field_2D(int row, int stride);
+
+/* Free the buffers of all the fields */
+void free_fields(struct Grid2D *g);
+
 /* Update the fields to the new time step for the next iteration */
 void update(struct FieldPointers *f);
 
@@ -21,6 +31,6 @@ void freeMem(int count, ...);
 double fmaxof(int count, ...);
 
 /* Find mamximum of an array */
-double fmaxarr(double **arr, int xmax, int ymax);
+double fmaxarr(double *arr, int xmax, int ymax, int st);
 
 #endif /* UTILITITES_H */
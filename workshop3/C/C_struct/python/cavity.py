@@ -0,0 +1,148 @@
+"""Run C_struct in memory from python, through lib/libcavity.so, built with
+-DUSE_SHARED=ON (CAVITY_LIB overrides its path). The options of lidCavity are
+passed as keywords, e.g.
+
+    from cavity import Cavity
+
+    with Cavity(nx=128, ny=128, Re=400, tol=1e-6) as c:
+        while c.step(1000) == Cavity.RUNNING:
+            print(c.iterations, c.residuals["total"])
+        u = c.field("u")
+        x, y, ug, vg, pg = c.grid_fields()
+
+The fields are NumPy views of the buffers of the solver, not copies.
+"""
+import ctypes
+import os
+
+import numpy as np
+
+_path = os.environ.get("CAVITY_LIB", os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), "..", "lib", "libcavity.so"))
+_lib = ctypes.CDLL(_path)
+
+_int_p = ctypes.POINTER(ctypes.c_int)
+_lib.cavity_init.argtypes = [ctypes.POINTER(ctypes.c_void_p), ctypes.c_int,
+                             ctypes.POINTER(ctypes.c_char_p)]
+_lib.cavity_init.restype = ctypes.c_int
+_lib.cavity_step.argtypes = [ctypes.c_void_p, ctypes.c_int]
+_lib.cavity_step.restype = ctypes.c_int
+_lib.cavity_iterations.argtypes = [ctypes.c_void_p]
+_lib.cavity_iterations.restype = ctypes.c_int
+_lib.cavity_residuals.argtypes = [ctypes.c_void_p]
+_lib.cavity_residuals.restype = ctypes.POINTER(ctypes.c_double)
+_lib.cavity_field.argtypes = [ctypes.c_void_p, ctypes.c_int, _int_p, _int_p,
+                              _int_p]
+_lib.cavity_field.restype = ctypes.POINTER(ctypes.c_double)
+_lib.cavity_grid.argtypes = [ctypes.c_void_p, _int_p,
+                             ctypes.POINTER(ctypes.c_double)]
+_lib.cavity_grid.restype = None
+_lib.cavity_free.argtypes = [ctypes.c_void_p]
+_lib.cavity_free.restype = None
+
+
+class Cavity:
+    # States of a case, as in enum CavityState
+    RUNNING, CONVERGED, DIVERGED, EXCEEDED = range(4)
+
+    # Fields, as in enum CavityField
+    FIELDS = {"u": 0, "v": 1, "p": 2}
+
+    # Residuals, in the order of cavity_residuals
+    RESIDUALS = ("total", "u", "v", "p", "div")
+
+    def __init__(self, *args, **options):
+        """Set up a case from the command line options of lidCavity, given as
+        strings in args or as keywords: nx=128 is --nx 128, mg_cycle="W" is
+        --mg-cycle W and a True flag, e.g. log_binary=True, is --log-binary.
+        Raises ValueError where lidCavity would exit instead, on invalid
+        options or --help."""
+        argv = ["lidCavity"] + [str(a) for a in args]
+        for key, value in options.items():
+            if value is False or value is None:
+                continue
+            argv.append("--" + key.replace("_", "-"))
+            if value is not True:
+                argv.append(str(value))
+
+        self._handle = ctypes.c_void_p()
+        c_argv = (ctypes.c_char_p * (len(argv) + 1))(
+            *[a.encode() for a in argv], None)
+        status = _lib.cavity_init(ctypes.byref(self._handle), len(argv),
+                                  c_argv)
+        if status >= 0:
+            self._handle = None
+            raise ValueError("invalid options: " + " ".join(argv[1:]))
+
+        n = (ctypes.c_int * 2)()
+        d = (ctypes.c_double * 2)()
+        _lib.cavity_grid(self._handle, n, d)
+        self.nx, self.ny = n
+        self.dx, self.dy = d
+        self.state = Cavity.RUNNING
+
+    def _check(self):
+        if not self._handle:
+            raise ValueError("the case is closed")
+        return self._handle
+
+    def step(self, n=1):
+        """Carry out up to n iterations, stopping once the case converges,
+        diverges or reaches its maximum number of iterations; returns the
+        state of the case"""
+        self.state = _lib.cavity_step(self._check(), n)
+        return self.state
+
+    @property
+    def iterations(self):
+        """Number of iterations carried out so far"""
+        return _lib.cavity_iterations(self._check())
+
+    @property
+    def residuals(self):
+        """Residuals of the last iteration"""
+        errs = _lib.cavity_residuals(self._check())
+        return {k: errs[i] for i, k in enumerate(Cavity.RESIDUALS)}
+
+    def field(self, name):
+        """Latest values of the field "u", "v" or "p" on its staggered points,
+        as a view of the buffer of the solver: u is nx x (ny + 1), v is
+        (nx + 1) x ny and p is (nx + 1) x (ny + 1). The buffers are swapped in
+        each iteration, so the view is outdated after the next step and must
+        be taken again; it is invalid once the case is closed."""
+        rows, cols, stride = ctypes.c_int(), ctypes.c_int(), ctypes.c_int()
+        data = _lib.cavity_field(self._check(), Cavity.FIELDS[name],
+                                 ctypes.byref(rows), ctypes.byref(cols),
+                                 ctypes.byref(stride))
+        buf = (ctypes.c_double * (rows.value * stride.value)).from_address(
+            ctypes.addressof(data.contents))
+        # Keep the case alive as long as the view
+        buf.owner = self
+        return np.ndarray((rows.value, cols.value), dtype=np.float64,
+                          buffer=buf, strides=(stride.value * 8, 8))
+
+    def grid_fields(self):
+        """Coordinates and fields averaged to the nx x ny grid points, as
+        written by lidCavity to data/xyuvp; these are copies"""
+        u, v, p = self.field("u"), self.field("v"), self.field("p")
+        ug = 0.5 * (u[:, 1:] + u[:, :-1])
+        vg = 0.5 * (v[1:, :] + v[:-1, :])
+        pg = 0.25 * (p[:-1, :-1] + p[1:, :-1] + p[:-1, 1:] + p[1:, 1:])
+        x, y = np.meshgrid(np.arange(self.nx) * self.dx,
+                           np.arange(self.ny) * self.dy, indexing="ij")
+        return x, y, ug, vg, pg
+
+    def close(self):
+        """Free the case; the views of its fields are invalid afterwards"""
+        if self._handle:
+            _lib.cavity_free(self._handle)
+            self._handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
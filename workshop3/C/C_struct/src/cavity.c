@@ -0,0 +1,124 @@
+#include "cavity.h"
+
+/* Set up a case from the options of lidCavity */
+int cavity_init(struct Cavity **cp, int argc, char *argv[]) {
+  int status;
+  struct Cavity *c = (struct Cavity *)calloc(1, sizeof(*c));
+
+  *cp = NULL;
+  if (!c) {
+    printf("Memory allocation error.\n");
+    return EXIT_FAILURE;
+  }
+
+  /* Boundary conditions: {top, left, bottom, right} */
+  c->s = ((struct SimulationInfo){.ubc = {1.0, 0.0, 0.0, 0.0},
+                                  .vbc = {0.0, 0.0, 0.0, 0.0},
+                                  .pbc = {0.0, 0.0, 0.0, 0.0}});
+  c->s.l_lid = 1.0;
+
+  status = parse_config(argc, argv, &c->g, &c->s);
+  if (status >= 0) {
+    free(c);
+    return status;
+  }
+
+  initialize(&c->f, &c->g, &c->s);
+  set_init(&c->f, &c->g, &c->s);
+  set_delt(&c->f, &c->g, &c->s);
+#if !defined(FUSED) && !defined(INPLACE)
+  mg_init(&c->mg, &c->g, &c->s);
+#endif
+
+  c->itr = 1;
+  c->state = CAVITY_RUNNING;
+  *cp = c;
+  return -1;
+}
+
+/* Carry out up to n iterations, stopping once the case is no longer
+ * running */
+int cavity_step(struct Cavity *c, int n) {
+  struct FieldPointers *f = &c->f;
+  struct Grid2D *g = &c->g;
+  struct SimulationInfo *s = &c->s;
+
+  for (int k = 0; k < n && c->state == CAVITY_RUNNING; k++) {
+#ifdef FUSED
+    /* Residuals are only available for the last of the steps */
+    solve_fused(f, g, s, FUSED_STEPS);
+    c->itr += FUSED_STEPS - 1;
+#elif defined(INPLACE)
+    solve_inplace(f, g, s);
+#else
+    if (c->mg.nlevels > 1) {
+      /* Each iteration is a multigrid cycle */
+      mg_cycle(&c->mg, f, g, s);
+    } else {
+      solve_U(f, g, s);
+      set_UBC(f, g, s);
+      solve_P(f, g, s);
+      set_PBC(f, g, s);
+      l2_norm(f, g, s);
+    }
+#endif
+
+    /* The fields of a diverged case are left as they came out */
+    if (isnan(s->errs[0])) {
+      c->state = CAVITY_DIVERGED;
+      break;
+    }
+
+    /* Update the fields */
+    update(f);
+    c->itr += 1;
+
+    if (s->errs[0] <= s->tol) {
+      c->state = CAVITY_CONVERGED;
+    } else if (c->itr >= s->itr_max) {
+      c->state = CAVITY_EXCEEDED;
+    }
+  }
+  return c->state;
+}
+
+/* Number of iterations carried out so far */
+int cavity_iterations(const struct Cavity *c) { return c->itr - 1; }
+
+/* Residuals of the last iteration */
+const double *cavity_residuals(const struct Cavity *c) { return c->s.errs; }
+
+/* Get the latest values of a field */
+double *cavity_field(struct Cavity *c, int field, int *rows, int *cols,
+                     int *stride) {
+  /* u has a row less than v and p, and v a column less than u and p */
+  const int nrows[3] = {c->g.nx, c->g.nx + 1, c->g.nx + 1};
+  const int ncols[3] = {c->g.ny + 1, c->g.ny, c->g.ny + 1};
+  double *data[3] = {c->f.u, c->f.v, c->f.p};
+
+  if (field < CAVITY_U || field > CAVITY_P) {
+    return NULL;
+  }
+  *rows = nrows[field];
+  *cols = ncols[field];
+  *stride = c->g.stride;
+  return data[field];
+}
+
+/* Grid size and spacing */
+void cavity_grid(const struct Cavity *c, int *n, double *d) {
+  n[0] = c->g.nx;
+  n[1] = c->g.ny;
+  d[0] = c->g.dx;
+  d[1] = c->g.dy;
+}
+
+/* Free a case */
+void cavity_free(struct Cavity *c) {
+  if (!c) {
+    return;
+  }
+  free_fields(&c->g);
+  mg_free(&c->mg);
+  free(c);
+}
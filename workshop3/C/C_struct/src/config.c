@@ -0,0 +1,216 @@
+#include "config.h"
+
+/* Print the usage */
+static void usage(const char *name, FILE *fd) {
+  fprintf(fd,
+          "Usage: %s [OPTION]... [Re]\n"
+          "options:\n"
+          "  --nx <int>        Number of grid points in x (default %d)\n"
+          "  --ny <int>        Number of grid points in y (default %d)\n"
+          "  --Re <float>      Reynolds number (default 100)\n"
+          "  --tol <float>     Convergence tolerance (default 1e-7)\n"
+          "  --itr-max <int>   Maximum number of iterations (default 1000000)\n"
+          "  --cfl <float>     CFL number (default based on Re)\n"
+          "  --c2 <float>      Artificial sound speed squared (default based "
+          "on Re)\n"
+          "  --log-itr <int>   Iterations between logged residuals (default "
+          "1)\n"
+          "  --log-binary      Log the residuals in binary to "
+          "data/residual.bin\n"
+          "  --smoothing <float> Coefficient of the implicit residual "
+          "smoothing\n"
+          "  --mg-levels <int> Number of multigrid levels (default 1, none)\n"
+          "  --mg-cycle <V|W>  Multigrid cycle (default V)\n"
+          "  --mg-pre <int>    Iterations before the coarse grid correction "
+          "(default 2)\n"
+          "  --mg-post <int>   Iterations after the coarse grid correction "
+          "(default 2)\n"
+          "  -h, --help        Print the usage\n",
+          name, IX, IY);
+}
+
+/* Parse a number that must be positive; returns 0 if it is not */
+static int positive(const char *opt, const char *arg, double *x) {
+  char *ptr;
+
+  *x = strtod(arg, &ptr);
+  if (ptr == arg || *ptr != '\0' || !(*x > 0.0)) {
+    fprintf(stderr, "Invalid value '%s' for %s\n", arg, opt);
+    return 0;
+  }
+  return 1;
+}
+
+/* Parse a whole number that must be positive and fit in an int; returns 0 if
+ * it does not */
+static int positive_int(const char *opt, const char *arg, int *n) {
+  char *ptr;
+  long x;
+
+  errno = 0;
+  x = strtol(arg, &ptr, 10);
+  if (ptr == arg || *ptr != '\0' || errno == ERANGE || x < 1 ||
+      x > INT_MAX) {
+    fprintf(stderr, "Invalid value '%s' for %s, expected a whole number from "
+                    "1 to %d\n",
+            arg, opt, INT_MAX);
+    return 0;
+  }
+  *n = (int)x;
+  return 1;
+}
+
+/* Set the grid size and the case parameters from the command line; returns
+ * -1 to go on, or the exit status */
+int parse_config(int argc, char *argv[], struct Grid2D *g,
+                 struct SimulationInfo *s) {
+  int opt, k, ok = 1;
+  const char *name;
+  static const struct option options[] = {
+      {"nx", required_argument, 0, 'x'},  {"ny", required_argument, 0, 'y'},
+      {"Re", required_argument, 0, 'r'},  {"tol", required_argument, 0, 't'},
+      {"itr-max", required_argument, 0, 'i'},
+      {"cfl", required_argument, 0, 'f'}, {"c2", required_argument, 0, 'c'},
+      {"log-itr", required_argument, 0, 'l'},
+      {"log-binary", no_argument, 0, 'b'},
+      {"smoothing", required_argument, 0, 'S'},
+      {"mg-levels", required_argument, 0, 'm'},
+      {"mg-cycle", required_argument, 0, 'C'},
+      {"mg-pre", required_argument, 0, 'a'},
+      {"mg-post", required_argument, 0, 'z'},
+      {"help", no_argument, 0, 'h'},      {0, 0, 0, 0}};
+
+  g->nx = IX;
+  g->ny = IY;
+  s->Re = 100.0;
+  s->tol = 1.0e-7;
+  s->itr_max = 1000000;
+  s->log_itr = 1;
+  s->log_binary = 0;
+  s->irs = 0.0;
+  s->mg_levels = 1;
+  s->mg_gamma = 1;
+  s->mg_pre = 2;
+  s->mg_post = 2;
+
+  /* The library may parse several command lines in one process */
+  optind = 1;
+  while (ok && (opt = getopt_long(argc, argv, "h", options, &k)) != -1) {
+    if (opt == 'h') {
+      usage(argv[0], stdout);
+      return EXIT_SUCCESS;
+    }
+    if (opt == '?') {
+      ok = 0;
+      break;
+    }
+    if (opt == 'b') {
+      s->log_binary = 1;
+      continue;
+    }
+    if (opt == 'C') {
+      if (strcmp(optarg, "V") && strcmp(optarg, "W")) {
+        fprintf(stderr, "Invalid value '%s' for %s\n", optarg,
+                options[k].name);
+        ok = 0;
+      }
+      s->mg_gamma = optarg[0] == 'W' ? 2 : 1;
+      continue;
+    }
+
+    name = options[k].name;
+    switch (opt) {
+    case 'x':
+      ok = positive_int(name, optarg, &g->nx);
+      break;
+    case 'y':
+      ok = positive_int(name, optarg, &g->ny);
+      break;
+    case 'r':
+      ok = positive(name, optarg, &s->Re);
+      break;
+    case 't':
+      ok = positive(name, optarg, &s->tol);
+      break;
+    case 'i':
+      ok = positive_int(name, optarg, &s->itr_max);
+      break;
+    case 'f':
+      ok = positive(name, optarg, &s->cfl);
+      break;
+    case 'c':
+      ok = positive(name, optarg, &s->c2);
+      break;
+    case 'l':
+      ok = positive_int(name, optarg, &s->log_itr);
+      break;
+    case 'S':
+      ok = positive(name, optarg, &s->irs);
+      break;
+    case 'm':
+      ok = positive_int(name, optarg, &s->mg_levels);
+      break;
+    case 'a':
+      ok = positive_int(name, optarg, &s->mg_pre);
+      break;
+    case 'z':
+      ok = positive_int(name, optarg, &s->mg_post);
+      break;
+    }
+  }
+
+  /* Reynolds number may also be given as the first argument */
+  if (ok && optind < argc) {
+    ok = positive("Re", argv[optind], &s->Re);
+  }
+
+  /* At least one interior point of each field in each direction */
+  if (ok && (g->nx < 3 || g->ny < 3)) {
+    fprintf(stderr, "The grid needs at least 3 x 3 points\n");
+    ok = 0;
+  }
+  /* The points of a field, its rows padded to a cache line, are indexed with
+   * an int */
+  if (ok && ((double)g->nx + 1) * ((double)g->ny + 1 + ALIGN) > INT_MAX) {
+    fprintf(stderr, "The grid of %d x %d points is too large\n", g->nx, g->ny);
+    ok = 0;
+  }
+  if (ok && (s->itr_max < 1 || s->log_itr < 1 || s->mg_levels < 1 ||
+             s->mg_pre < 1 || s->mg_post < 1)) {
+    fprintf(stderr, "The number of iterations must be at least 1\n");
+    ok = 0;
+  }
+#ifdef INPLACE
+  /* Both need the fields of the last iteration */
+  if (ok && (s->irs > 0.0 || s->mg_levels > 1)) {
+    fprintf(stderr, "The in-place sweep supports neither smoothing nor "
+                    "multigrid\n");
+    ok = 0;
+  }
+#endif
+#ifdef FUSED
+  /* The fused sweep does not smooth and runs on the finest grid alone */
+  if (ok && (s->irs > 0.0 || s->mg_levels > 1)) {
+    fprintf(stderr, "The fused sweep supports neither smoothing nor "
+                    "multigrid\n");
+    ok = 0;
+  }
+#endif
+
+  if (!ok) {
+    usage(argv[0], stderr);
+    return EXIT_FAILURE;
+  }
+  return -1;
+}
+
+/* Set the grid size and the case parameters from the command line, or
+ * terminate on --help or invalid arguments */
+void read_config(int argc, char *argv[], struct Grid2D *g,
+                 struct SimulationInfo *s) {
+  int status = parse_config(argc, argv, g, s);
+
+  if (status >= 0) {
+    exit(status);
+  }
+}
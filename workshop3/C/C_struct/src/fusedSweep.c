@@ -0,0 +1,264 @@
+#include "fusedSweep.h"
+
+#ifdef FUSED
+/* The fused sweep evaluates the same expressions as solve_U, solve_P and
+ * l2_norm, row by row, so that the rows of u, v and p read by the momentum
+ * equations are still in cache when the continuity equation and the residuals
+ * need them. p of row i only needs u of rows i and i - 1 and v of row i, so a
+ * row can be finished as soon as its velocities are. The updated fields are
+ * the same as those of the separate loops; only the residual sums are added
+ * up in a different order. */
+
+/* Set the walls of u and v, which do not depend on the solution */
+static void set_walls(double *un, double *vn, struct Grid2D *g,
+                      struct SimulationInfo *s) {
+  int i, j, st = g->stride;
+
+  for (j = 0; j < g->ny + 1; j++) {
+    un[IDX(0, j)] = s->ubc[1];
+    un[IDX(g->nx - 1, j)] = s->ubc[3];
+  }
+  un[IDX(0, 0)] = 2.0 * s->ubc[2] - un[IDX(0, 1)];
+  un[IDX(0, g->ny)] = 2.0 * s->ubc[0] - un[IDX(0, g->ny - 1)];
+  un[IDX(g->nx - 1, 0)] = 2.0 * s->ubc[2] - un[IDX(g->nx - 1, 1)];
+  un[IDX(g->nx - 1, g->ny)] = 2.0 * s->ubc[0] - un[IDX(g->nx - 1, g->ny - 1)];
+
+  for (i = 0; i < g->nx + 1; i++) {
+    vn[IDX(i, 0)] = s->vbc[2];
+    vn[IDX(i, g->ny - 1)] = s->vbc[0];
+  }
+}
+
+/* Update u and v on the columns [js, je) of row i and apply the boundary
+ * conditions that only depend on this row */
+static void momentum_row(struct FieldPointers *f, struct Grid2D *g,
+                         struct SimulationInfo *s, int i, int js, int je) {
+  int j, st = g->stride;
+  double *restrict un = f->un, *restrict vn = f->vn;
+  const double *restrict u = f->u, *restrict v = f->v, *restrict p = f->p;
+
+  if (i < g->nx - 1) {
+    for (j = (js > 1 ? js : 1); j < (je < g->ny ? je : g->ny); j++) {
+      un[IDX(i, j)] =
+          u[IDX(i, j)] -
+          0.25 * s->dtdx *
+              (pow(u[IDX(i + 1, j)] + u[IDX(i, j)], 2) -
+               pow(u[IDX(i, j)] + u[IDX(i - 1, j)], 2)) -
+          0.25 * s->dtdy *
+              ((u[IDX(i, j + 1)] + u[IDX(i, j)]) *
+                   (v[IDX(i + 1, j)] + v[IDX(i, j)]) -
+               (u[IDX(i, j)] + u[IDX(i, j - 1)]) *
+                   (v[IDX(i + 1, j - 1)] + v[IDX(i, j - 1)])) -
+          s->dtdx * (p[IDX(i + 1, j)] - p[IDX(i, j)]) +
+          s->nu * (s->dtdxx * (u[IDX(i + 1, j)] - 2.0 * u[IDX(i, j)] +
+                               u[IDX(i - 1, j)]) +
+                   s->dtdyy * (u[IDX(i, j + 1)] - 2.0 * u[IDX(i, j)] +
+                               u[IDX(i, j - 1)]));
+    }
+
+    /* Bottom and top */
+    if (js <= 1 && 1 < je) {
+      un[IDX(i, 0)] = 2.0 * s->ubc[2] - un[IDX(i, 1)];
+    }
+    if (js <= g->ny - 1 && g->ny - 1 < je) {
+      un[IDX(i, g->ny)] = 2.0 * s->ubc[0] - un[IDX(i, g->ny - 1)];
+    }
+  }
+
+  for (j = (js > 1 ? js : 1); j < (je < g->ny - 1 ? je : g->ny - 1); j++) {
+    vn[IDX(i, j)] =
+        v[IDX(i, j)] -
+        0.25 * s->dtdx *
+            ((u[IDX(i, j + 1)] + u[IDX(i, j)]) *
+                 (v[IDX(i + 1, j)] + v[IDX(i, j)]) -
+             (u[IDX(i - 1, j + 1)] + u[IDX(i - 1, j)]) *
+                 (v[IDX(i, j)] + v[IDX(i - 1, j)])) -
+        0.25 * s->dtdy *
+            (pow(v[IDX(i, j + 1)] + v[IDX(i, j)], 2) -
+             pow(v[IDX(i, j)] + v[IDX(i, j - 1)], 2)) -
+        s->dtdy * (p[IDX(i, j + 1)] - p[IDX(i, j)]) +
+        s->nu * (s->dtdxx * (v[IDX(i + 1, j)] - 2.0 * v[IDX(i, j)] +
+                             v[IDX(i - 1, j)]) +
+                 s->dtdyy * (v[IDX(i, j + 1)] - 2.0 * v[IDX(i, j)] +
+                             v[IDX(i, j - 1)]));
+  }
+
+  /* Sides */
+  if (i == 1 || i == g->nx - 1) {
+    int k = (i == 1) ? 0 : g->nx;
+    double vbc = (i == 1) ? s->vbc[1] : s->vbc[3];
+
+    for (j = (js > 1 ? js : 1); j < (je < g->ny - 1 ? je : g->ny - 1); j++) {
+      vn[IDX(k, j)] = 2.0 * vbc - vn[IDX(i, j)];
+    }
+  }
+}
+
+/* Update p on the columns [js, je) of row i */
+static void continuity_row(struct FieldPointers *f, struct Grid2D *g,
+                           struct SimulationInfo *s, int i, int js, int je) {
+  int j, st = g->stride;
+  double *restrict pn = f->pn;
+  const double *restrict un = f->un, *restrict vn = f->vn, *restrict p = f->p;
+
+  for (j = (js > 1 ? js : 1); j < (je < g->ny ? je : g->ny); j++) {
+    pn[IDX(i, j)] =
+        p[IDX(i, j)] -
+        s->c2 * ((un[IDX(i, j)] - un[IDX(i - 1, j)]) * s->dtdx +
+                 (vn[IDX(i, j)] - vn[IDX(i, j - 1)]) * s->dtdy);
+  }
+}
+
+/* Add the residual contributions of the columns [js, je) of row i to errs =
+ * {u err, v err, p err, div U} */
+static void residual_row(struct FieldPointers *f, struct Grid2D *g,
+                         struct SimulationInfo *s, int i, int js, int je,
+                         double *errs) {
+  int j, st = g->stride;
+  double err_u = 0.0, err_v = 0.0, err_p = 0.0, err_d = 0.0;
+  const double *restrict u = f->u, *restrict v = f->v, *restrict p = f->p;
+  const double *restrict un = f->un, *restrict vn = f->vn, *restrict pn = f->pn;
+
+  if (i >= g->nx - 1) {
+    return;
+  }
+  for (j = (js > 1 ? js : 1); j < (je < g->ny - 1 ? je : g->ny - 1); j++) {
+    err_u += pow(un[IDX(i, j)] - u[IDX(i, j)], 2);
+    err_v += pow(vn[IDX(i, j)] - v[IDX(i, j)], 2);
+    err_p += pow(pn[IDX(i, j)] - p[IDX(i, j)], 2);
+    err_d += (un[IDX(i, j)] - un[IDX(i - 1, j)]) * s->dtdx +
+             (vn[IDX(i, j)] - vn[IDX(i, j - 1)]) * s->dtdy;
+  }
+  errs[0] += err_u;
+  errs[1] += err_v;
+  errs[2] += err_p;
+  errs[3] += err_d;
+}
+
+/* One step over tiles of TILE_I rows and TILE_J columns. The rows of a block
+ * of TILE_I rows are handed to one thread, which goes through the tiles of the
+ * block from left to right, so vn of the column left of a tile is always up
+ * to date. p of the first row of a block needs u of the last row of the
+ * previous block, which belongs to another thread; these rows are finished
+ * after all the blocks are done. */
+static void sweep_tiles(struct FieldPointers *f, struct Grid2D *g,
+                        struct SimulationInfo *s, double *errs) {
+  int b, nblocks = (g->nx - 1 + TILE_I - 1) / TILE_I;
+  double err_u = 0.0, err_v = 0.0, err_p = 0.0, err_d = 0.0;
+
+#pragma omp parallel for private(b) schedule(static) \
+                             reduction(+:err_u, err_v, err_p, err_d)
+  for (b = 0; b < nblocks; b++) {
+    int i, js, is = 1 + b * TILE_I;
+    int ie = (is + TILE_I < g->nx) ? is + TILE_I : g->nx;
+    double e[4] = {0.0, 0.0, 0.0, 0.0};
+
+    for (js = 0; js < g->ny + 1; js += TILE_J) {
+      int je = (js + TILE_J < g->ny + 1) ? js + TILE_J : g->ny + 1;
+
+      for (i = is; i < ie; i++) {
+        momentum_row(f, g, s, i, js, je);
+        if (i > is || b == 0) {
+          continuity_row(f, g, s, i, js, je);
+          residual_row(f, g, s, i, js, je, e);
+        }
+      }
+    }
+    err_u += e[0];
+    err_v += e[1];
+    err_p += e[2];
+    err_d += e[3];
+  }
+
+#pragma omp parallel for private(b) schedule(static) \
+                             reduction(+:err_u, err_v, err_p, err_d)
+  for (b = 1; b < nblocks; b++) {
+    double e[4] = {0.0, 0.0, 0.0, 0.0};
+
+    continuity_row(f, g, s, 1 + b * TILE_I, 0, g->ny + 1);
+    residual_row(f, g, s, 1 + b * TILE_I, 0, g->ny + 1, e);
+    err_u += e[0];
+    err_v += e[1];
+    err_p += e[2];
+    err_d += e[3];
+  }
+
+  errs[0] = err_u;
+  errs[1] = err_v;
+  errs[2] = err_p;
+  errs[3] = err_d;
+}
+
+/* nsteps steps in a wavefront over the rows. Step t + 1 runs two rows behind
+ * step t; it then only needs rows of step t that are finished and only
+ * overwrites rows of step t - 1 that step t no longer reads, so both steps
+ * share the two buffers of each field. The steps on the rows of a wavefront
+ * are independent and are shared among the threads. */
+static void sweep_wavefront(struct FieldPointers *f, struct Grid2D *g,
+                            struct SimulationInfo *s, int nsteps,
+                            double *errs) {
+  int r, t;
+  double err_u = 0.0, err_v = 0.0, err_p = 0.0, err_d = 0.0;
+  /* Buffers of the even and the odd steps */
+  struct FieldPointers q[2] = {*f, {f->un, f->u, f->vn, f->v, f->pn, f->p}};
+
+  for (r = 1; r < g->nx + 2 * (nsteps - 1); r++) {
+#pragma omp parallel for private(t) schedule(static) \
+                             reduction(+:err_u, err_v, err_p, err_d)
+    for (t = 0; t < nsteps; t++) {
+      int i = r - 2 * t;
+      double e[4] = {0.0, 0.0, 0.0, 0.0};
+
+      if (i < 1 || i > g->nx - 1) {
+        continue;
+      }
+      momentum_row(&q[t % 2], g, s, i, 0, g->ny + 1);
+      continuity_row(&q[t % 2], g, s, i, 0, g->ny + 1);
+      if (t == nsteps - 1) {
+        residual_row(&q[t % 2], g, s, i, 0, g->ny + 1, e);
+        err_u += e[0];
+        err_v += e[1];
+        err_p += e[2];
+        err_d += e[3];
+      }
+    }
+  }
+
+  /* The last step went to the buffers of u, v and p */
+  if (nsteps % 2 == 0) {
+    *f = q[1];
+  }
+
+  errs[0] = err_u;
+  errs[1] = err_v;
+  errs[2] = err_p;
+  errs[3] = err_d;
+}
+
+/* Advance u, v and p by nsteps pseudo-time steps in one pass over memory and
+ * compute the residuals of the last step */
+void solve_fused(struct FieldPointers *f, struct Grid2D *g,
+                 struct SimulationInfo *s, int nsteps) {
+  int count;
+  double errs[4];
+
+  TIMER_START(T_FUSED);
+  set_walls(f->un, f->vn, g, s);
+  if (nsteps == 1) {
+    sweep_tiles(f, g, s, errs);
+  } else {
+    set_walls(f->u, f->v, g, s);
+    sweep_wavefront(f, g, s, nsteps, errs);
+  }
+  set_PBC(f, g, s);
+
+  s->errs[1] = sqrt(s->dtdxdy * errs[0]);
+  s->errs[2] = sqrt(s->dtdxdy * errs[1]);
+  s->errs[3] = sqrt(s->dtdxdy * errs[2]);
+  s->errs[4] = fabs(errs[3]);
+
+  count = 4;
+  s->errs[0] = fmaxof(count, s->errs[1], s->errs[2], s->errs[3], s->errs[4]);
+  TIMER_STOP();
+}
+#endif /* FUSED */
@@ -0,0 +1,204 @@
+#include "inplaceSweep.h"
+
+#ifdef INPLACE
+/* The in-place sweep evaluates the same expressions as solve_U and solve_P,
+ * but each one reads the latest values of the fields rather than those of the
+ * last iteration. The rows of u, then those of v, are split in two colours,
+ * the even and the odd ones counting from the first row updated; the stencil
+ * of a row only holds itself and rows of the other colour, so all the rows of
+ * the first colour are updated from the old second colour, and then those of
+ * the second from the new first colour (zebra Gauss-Seidel). A row is computed
+ * into a scratch row of the thread before it is written back, which keeps the
+ * inner loops contiguous, unlike a checkerboard of points, and gives the
+ * changes of the row for the residuals. p only depends on itself and on u
+ * and v, which are done by then, and is updated point by point. */
+
+/* Row updates of a field, computing the row into un first, returning the sum
+ * of their squared changes that l2_norm would add up */
+typedef double (*RowUpdate)(struct FieldPointers *f, struct Grid2D *g,
+                            struct SimulationInfo *s, int i,
+                            double *restrict un);
+
+/* Update row i of u in place */
+static double u_row(struct FieldPointers *f, struct Grid2D *g,
+                    struct SimulationInfo *s, int i, double *restrict un) {
+  int j, st = g->stride;
+  double err = 0.0;
+  double *restrict u = f->u;
+  const double *restrict v = f->v, *restrict p = f->p;
+
+  for (j = 1; j < g->ny; j++) {
+    un[j] =
+        u[IDX(i, j)] -
+        0.25 * s->dtdx *
+            (pow(u[IDX(i + 1, j)] + u[IDX(i, j)], 2) -
+             pow(u[IDX(i, j)] + u[IDX(i - 1, j)], 2)) -
+        0.25 * s->dtdy *
+            ((u[IDX(i, j + 1)] + u[IDX(i, j)]) *
+                 (v[IDX(i + 1, j)] + v[IDX(i, j)]) -
+             (u[IDX(i, j)] + u[IDX(i, j - 1)]) *
+                 (v[IDX(i + 1, j - 1)] + v[IDX(i, j - 1)])) -
+        s->dtdx * (p[IDX(i + 1, j)] - p[IDX(i, j)]) +
+        s->nu * (s->dtdxx * (u[IDX(i + 1, j)] - 2.0 * u[IDX(i, j)] +
+                             u[IDX(i - 1, j)]) +
+                 s->dtdyy * (u[IDX(i, j + 1)] - 2.0 * u[IDX(i, j)] +
+                             u[IDX(i, j - 1)]));
+  }
+
+  /* The last column is left out of the residuals */
+#pragma omp simd reduction(+:err)
+  for (j = 1; j < g->ny - 1; j++) {
+    err += pow(un[j] - u[IDX(i, j)], 2);
+    u[IDX(i, j)] = un[j];
+  }
+  u[IDX(i, j)] = un[j];
+  return err;
+}
+
+/* Update row i of v in place */
+static double v_row(struct FieldPointers *f, struct Grid2D *g,
+                    struct SimulationInfo *s, int i, double *restrict vn) {
+  int j, st = g->stride;
+  double err = 0.0;
+  double *restrict v = f->v;
+  const double *restrict u = f->u, *restrict p = f->p;
+
+  for (j = 1; j < g->ny - 1; j++) {
+    vn[j] =
+        v[IDX(i, j)] -
+        0.25 * s->dtdx *
+            ((u[IDX(i, j + 1)] + u[IDX(i, j)]) *
+                 (v[IDX(i + 1, j)] + v[IDX(i, j)]) -
+             (u[IDX(i - 1, j + 1)] + u[IDX(i - 1, j)]) *
+                 (v[IDX(i, j)] + v[IDX(i - 1, j)])) -
+        0.25 * s->dtdy *
+            (pow(v[IDX(i, j + 1)] + v[IDX(i, j)], 2) -
+             pow(v[IDX(i, j)] + v[IDX(i, j - 1)], 2)) -
+        s->dtdy * (p[IDX(i, j + 1)] - p[IDX(i, j)]) +
+        s->nu * (s->dtdxx * (v[IDX(i + 1, j)] - 2.0 * v[IDX(i, j)] +
+                             v[IDX(i - 1, j)]) +
+                 s->dtdyy * (v[IDX(i, j + 1)] - 2.0 * v[IDX(i, j)] +
+                             v[IDX(i, j - 1)]));
+  }
+
+#pragma omp simd reduction(+:err)
+  for (j = 1; j < g->ny - 1; j++) {
+    err += pow(vn[j] - v[IDX(i, j)], 2);
+    v[IDX(i, j)] = vn[j];
+  }
+
+  /* The last row is left out of the residuals */
+  return i < g->nx - 1 ? err : 0.0;
+}
+
+/* Number of the calling thread in its team */
+static int thread(void) {
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+/* Update the rows [first, last) of a field in one pass: each row of the second
+ * colour follows the row of the first colour after it, the last one it needs.
+ * The rows are handed out to the threads in blocks of TILE_I, an even number,
+ * so all the blocks start on the first colour; the last row of a block needs
+ * the first one of the next block, and these rows are finished after all the
+ * blocks are done. Each thread computes its rows into its own scratch row
+ * of g->rows. Returns the sum of the squared changes. */
+static double zebra(RowUpdate row, struct FieldPointers *f, struct Grid2D *g,
+                    struct SimulationInfo *s, int first, int last) {
+  int b, nblocks = (last - first + TILE_I - 1) / TILE_I;
+  double err = 0.0;
+
+#pragma omp parallel for private(b) schedule(static) reduction(+:err) \
+                             num_threads(g->nrows)
+  for (b = 0; b < nblocks; b++) {
+    int i, is = first + b * TILE_I;
+    int ie = (is + TILE_I < last) ? is + TILE_I : last;
+    double *un = g->rows + (size_t)thread() * g->stride;
+
+    for (i = is; i < ie; i += 2) {
+      err += row(f, g, s, i, un);
+      if (i > is) {
+        err += row(f, g, s, i - 1, un);
+      }
+    }
+    if (ie == last && (ie - is) % 2 == 0) {
+      err += row(f, g, s, ie - 1, un);
+    }
+  }
+
+#pragma omp parallel for private(b) schedule(static) reduction(+:err) \
+                             num_threads(g->nrows)
+  for (b = 0; b < nblocks - 1; b++) {
+    err += row(f, g, s, first + (b + 1) * TILE_I - 1,
+               g->rows + (size_t)thread() * g->stride);
+  }
+  return err;
+}
+
+/* Update p in place and add the sum of its squared changes and the
+ * divergence that l2_norm would add up to errs[2] and errs[3] */
+static void sweep_p(struct FieldPointers *f, struct Grid2D *g,
+                    struct SimulationInfo *s, double *errs) {
+  int i, j;
+  double err_p = 0.0, err_d = 0.0;
+  double *restrict p = f->p;
+  const double *restrict u = f->u, *restrict v = f->v;
+
+#pragma omp parallel for private(i, j) schedule(auto) \
+                             reduction(+:err_p, err_d)
+  for (i = 1; i < g->nx; i++) {
+    const int st = g->stride;
+    double ep = 0.0, ed = 0.0;
+
+    /* The last column is left out of the residuals */
+#pragma omp simd reduction(+:ep, ed)
+    for (j = 1; j < g->ny - 1; j++) {
+      double div = (u[IDX(i, j)] - u[IDX(i - 1, j)]) * s->dtdx +
+                   (v[IDX(i, j)] - v[IDX(i, j - 1)]) * s->dtdy;
+
+      ep += pow(s->c2 * div, 2);
+      ed += div;
+      p[IDX(i, j)] -= s->c2 * div;
+    }
+    p[IDX(i, j)] -= s->c2 * ((u[IDX(i, j)] - u[IDX(i - 1, j)]) * s->dtdx +
+                             (v[IDX(i, j)] - v[IDX(i, j - 1)]) * s->dtdy);
+
+    /* And so is the last row */
+    if (i < g->nx - 1) {
+      err_p += ep;
+      err_d += ed;
+    }
+  }
+
+  errs[2] = err_p;
+  errs[3] = err_d;
+}
+
+/* Advance u, v and p by one red-black Gauss-Seidel sweep over the rows in
+ * place and compute its residuals */
+void solve_inplace(struct FieldPointers *f, struct Grid2D *g,
+                   struct SimulationInfo *s) {
+  int count;
+  double errs[4];
+
+  TIMER_START(T_INPLACE);
+  errs[0] = zebra(u_row, f, g, s, 1, g->nx - 1);
+  errs[1] = zebra(v_row, f, g, s, 1, g->nx);
+  set_UBC(f, g, s);
+  sweep_p(f, g, s, errs);
+  set_PBC(f, g, s);
+
+  s->errs[1] = sqrt(s->dtdxdy * errs[0]);
+  s->errs[2] = sqrt(s->dtdxdy * errs[1]);
+  s->errs[3] = sqrt(s->dtdxdy * errs[2]);
+  s->errs[4] = fabs(errs[3]);
+
+  count = 4;
+  s->errs[0] = fmaxof(count, s->errs[1], s->errs[2], s->errs[3], s->errs[4]);
+  TIMER_STOP();
+}
+#endif /* INPLACE */
@@ -26,77 +26,62 @@ Boundary Conditions: u, v -> Dirichlet (as shown below)
                              ---------------
                                   u=0, v=0
 \*============================================================================*/
-#include "simulationControls.h"
+#include "cavity.h"
+#include "residualLog.h"
 #include "writer.h"
 
 int main(int argc, char *argv[]) {
-  int itr = 1, count;
-  const double tol = 1.0e-7;
-  const int itr_max = 1000000;
+  int itr, state;
+  struct Cavity *c;
 
-  FILE *flog;
+  /* Log of the residuals */
+  static struct ResidualLog flog;
 
-  g.nx = IX;
-  g.ny = IY;
-
-  /* Boundary conditions: {top, left, bottom, right} */
-  s = ((struct SimulationInfo){.ubc = {1.0, 0.0, 0.0, 0.0},
-                               .vbc = {0.0, 0.0, 0.0, 0.0},
-                               .pbc = {0.0, 0.0, 0.0, 0.0}});
-
-  s.Re = 100.0;
-  s.l_lid = 1.0;
-
-  /* Getting Reynolds number */
-  if (argc > 1) {
-    char *ptr;
-    s.Re = strtod(argv[1], &ptr);
+  /* Getting grid size, Reynolds number and solver settings, and setting up
+   * the case */
+  state = cavity_init(&c, argc, argv);
+  if (state >= 0) {
+    exit(state);
   }
-  printf("Re number is set to %d\n", (int)s.Re);
+  printf("Re number is set to %d\n", (int)c->s.Re);
+  printf("Grid size is set to %d x %d\n", c->g.nx, c->g.ny);
 
   /* Create a log file for outputting the residuals */
-  flog = fopen("data/residual", "w+t+e");
-  fprintf(flog, "# iteration\ttotal\tu\tv\tp\tdivergence\n");
-
-  initialize(&f, &g, &s);
-  set_init(&f, &g, &s);
-  set_delt(&f, &g, &s);
+  log_open(&flog, c->s.log_binary, 0);
 
   /* Start the main loop */
+  TIMER_INIT();
   do {
-    solve_U(&f, &g, &s);
-    set_UBC(&f, &g, &s);
-    solve_P(&f, &g, &s);
-    set_PBC(&f, &g, &s);
-    l2_norm(&f, &g, &s);
+    state = cavity_step(c, 1);
+    itr = cavity_iterations(c);
 
     /* Check if solution diverged */
-    if (isnan(s.errs[0])) {
-      printf("Solution Diverged after %d iterations!\n", itr);
+    if (state == CAVITY_DIVERGED) {
+      printf("Solution Diverged after %d iterations!\n", itr + 1);
 
       /* Free the memory and terminate */
-      count = 6;
-      freeMem(count, g.ubufo, g.vbufo, g.pbufo, g.ubufn, g.vbufn, g.pbufn);
-      fclose(flog);
+      cavity_free(c);
+      log_close(&flog);
       exit(EXIT_FAILURE);
     }
-    fprintf(flog, "%d\t%.8lf\t%.8lf\t%.8lf\t%.8lf\t%.8lf\n", itr, s.errs[0],
-            s.errs[1], s.errs[2], s.errs[3], s.errs[4]);
-
-    /* Update the fields */
-    update(&f);
-    itr += 1;
-  } while (s.errs[0] > tol && itr < itr_max);
+    TIMER_START(T_OUTPUT);
+    if (itr % c->s.log_itr == 0 || state == CAVITY_CONVERGED) {
+      log_residuals(&flog, itr, c->s.errs);
+    }
+    TIMER_STOP();
+  } while (state == CAVITY_RUNNING);
+  TIMER_REPORT();
 
-  if (itr == itr_max) {
-    printf("Maximum number of iterations (%d) exceeded\n", itr);
+  if (state == CAVITY_EXCEEDED) {
+    printf("Maximum number of iterations (%d) exceeded\n", itr + 1);
   } else {
-    printf("Converged after %d iterations\n", itr);
+    printf("Converged after %d iterations\n", itr + 1);
   }
 
-  fclose(flog);
+  log_close(&flog);
 
   /* Write output data */
-  dump_data(&g, &f);
+  dump_data(&c->g, &c->f);
+  cavity_free(c);
   return 0;
 }
@@ -0,0 +1,338 @@
+#include "multigrid.h"
+
+/* Full Approximation Scheme on the staggered grid. A p cell of a coarse level
+ * covers 2 x 2 cells of the finer one and a u or v face of it two faces. The
+ * smoother is the iteration of the single grid solver, q -> q + dt R(q) for
+ * the residual R of the state q. On a coarse level it is driven by the source
+ * term S = I r - R(I q), with I q and I r the restricted state and residual of
+ * the finer level, so that it starts from the residual of the finer level;
+ * the change it makes to I q is prolongated back as the correction. */
+
+/* Index of the point (i, j) of a field of the coarser level */
+#define CDX(i, j) ((i) * sc + (j))
+
+/* Set the time step of a coarse level and the operations on it */
+static void set_level_dt(struct Grid2D *g, struct SimulationInfo *s,
+                         double dt) {
+  s->dt = dt;
+  s->dtdx = s->dt / g->dx;
+  s->dtdy = s->dt / g->dy;
+  s->dtdxx = s->dt / (g->dx * g->dx);
+  s->dtdyy = s->dt / (g->dy * g->dy);
+  s->dtdxdy = s->dt * g->dx * g->dy;
+}
+
+/* Add dt times the source term of a field to its new values on
+ * [1, ie) x [1, je) */
+static void add_source(double *restrict xn, const double *restrict src,
+                       int ie, int je, int st, double dt) {
+  int i, j;
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = 1; i < ie; i++) {
+    for (j = 1; j < je; j++) {
+      xn[IDX(i, j)] += dt * src[IDX(i, j)];
+    }
+  }
+}
+
+/* Subtract the residual of a field, (xn - x) / dt, from its source term on
+ * [1, ie) x [1, je) */
+static void sub_residual(double *restrict src, const double *restrict xn,
+                         const double *restrict x, int ie, int je, int st,
+                         double dt) {
+  int i, j;
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = 1; i < ie; i++) {
+    for (j = 1; j < je; j++) {
+      src[IDX(i, j)] -= (xn[IDX(i, j)] - x[IDX(i, j)]) / dt;
+    }
+  }
+}
+
+/* Iteration of the single grid solver on a level, driven by its source terms
+ * if any; the new fields are left in un, vn and pn */
+static void step(struct MGLevel *lv, struct FieldPointers *f, struct Grid2D *g,
+                 struct SimulationInfo *s) {
+  solve_U(f, g, s);
+  if (lv->su) {
+    add_source(f->un, lv->su, g->nx - 1, g->ny, g->stride, s->dt);
+    add_source(f->vn, lv->sv, g->nx, g->ny - 1, g->stride, s->dt);
+  }
+  set_UBC(f, g, s);
+  solve_P(f, g, s);
+  if (lv->sp) {
+    add_source(f->pn, lv->sp, g->nx, g->ny, g->stride, s->dt);
+  }
+  set_PBC(f, g, s);
+}
+
+/* Restrict the state of a level, in u, v and p, and its residual, from un, vn
+ * and pn, to the next coarser level c, and set the source terms of c. States
+ * are averaged over the faces and cells they cover; the residuals of u and v
+ * are weighted by 1/8 (1 2 1) across the faces. */
+static void restrict_level(struct FieldPointers *f, struct Grid2D *g,
+                           struct SimulationInfo *s, struct MGLevel *c) {
+  int i, j, st = g->stride, sc = c->g.stride;
+  const double rdt = 1.0 / s->dt;
+  const double *restrict u = f->u, *restrict v = f->v, *restrict p = f->p;
+  const double *restrict un = f->un, *restrict vn = f->vn, *restrict pn = f->pn;
+  double *restrict uc = c->f.un, *restrict vc = c->f.vn, *restrict pc = c->f.pn;
+  double *restrict su = c->su, *restrict sv = c->sv, *restrict sp = c->sp;
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = 1; i < c->g.nx - 1; i++) {
+    for (j = 1; j < c->g.ny; j++) {
+      int k = IDX(2 * i, 2 * j);
+
+      uc[CDX(i, j)] = 0.5 * (u[k - 1] + u[k]);
+      su[CDX(i, j)] = 0.125 * rdt *
+                      (un[k - st - 1] - u[k - st - 1] + un[k - st] - u[k - st] +
+                       2.0 * (un[k - 1] - u[k - 1] + un[k] - u[k]) +
+                       un[k + st - 1] - u[k + st - 1] + un[k + st] - u[k + st]);
+    }
+  }
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = 1; i < c->g.nx; i++) {
+    for (j = 1; j < c->g.ny - 1; j++) {
+      int k = IDX(2 * i, 2 * j);
+
+      vc[CDX(i, j)] = 0.5 * (v[k - st] + v[k]);
+      sv[CDX(i, j)] = 0.125 * rdt *
+                      (vn[k - st - 1] - v[k - st - 1] + vn[k - 1] - v[k - 1] +
+                       2.0 * (vn[k - st] - v[k - st] + vn[k] - v[k]) +
+                       vn[k - st + 1] - v[k - st + 1] + vn[k + 1] - v[k + 1]);
+    }
+  }
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = 1; i < c->g.nx; i++) {
+    for (j = 1; j < c->g.ny; j++) {
+      int k = IDX(2 * i, 2 * j);
+
+      pc[CDX(i, j)] = 0.25 * (p[k - st - 1] + p[k - st] + p[k - 1] + p[k]);
+      sp[CDX(i, j)] = 0.25 * rdt *
+                      (pn[k - st - 1] - p[k - st - 1] + pn[k - st] - p[k - st] +
+                       pn[k - 1] - p[k - 1] + pn[k] - p[k]);
+    }
+  }
+
+  /* The restricted state, boundary conditions included, becomes the state of
+   * c and is kept to find the change from it */
+  set_UBC(&c->f, &c->g, &c->s);
+  set_PBC(&c->f, &c->g, &c->s);
+  memcpy(c->u0, c->f.un, sizeof(double) * c->g.nx * sc);
+  memcpy(c->v0, c->f.vn, sizeof(double) * (c->g.nx + 1) * sc);
+  memcpy(c->p0, c->f.pn, sizeof(double) * (c->g.nx + 1) * sc);
+  update(&c->f);
+
+  /* S = I r - R(I q); p is updated from the new u and v, so its residual is
+   * taken after them, with their source terms added */
+  solve_U(&c->f, &c->g, &c->s);
+  sub_residual(su, c->f.un, c->f.u, c->g.nx - 1, c->g.ny, sc, c->s.dt);
+  sub_residual(sv, c->f.vn, c->f.v, c->g.nx, c->g.ny - 1, sc, c->s.dt);
+  add_source(c->f.un, su, c->g.nx - 1, c->g.ny, sc, c->s.dt);
+  add_source(c->f.vn, sv, c->g.nx, c->g.ny - 1, sc, c->s.dt);
+  set_UBC(&c->f, &c->g, &c->s);
+  solve_P(&c->f, &c->g, &c->s);
+  sub_residual(sp, c->f.pn, c->f.p, c->g.nx, c->g.ny, sc, c->s.dt);
+}
+
+/* Replace the restricted state x0 of a field of n points by the change x - x0
+ * of it */
+static void change(double *restrict x0, const double *restrict x, int n) {
+  int k;
+
+#pragma omp parallel for private(k) schedule(auto)
+  for (k = 0; k < n; k++) {
+    x0[k] = x[k] - x0[k];
+  }
+}
+
+/* Linear interpolation at a quarter of the way from the point k to kn */
+static inline double lin(const double *e, int k, int kn) {
+  return 0.75 * e[k] + 0.25 * e[kn];
+}
+
+/* Correct the state of a level by the change of the next coarser level c,
+ * prolongated bilinearly; the corrected fields are left in un, vn and pn */
+static void correct(struct FieldPointers *f, struct Grid2D *g,
+                    struct SimulationInfo *s, struct MGLevel *c) {
+  int i, j, st = g->stride, sc = c->g.stride;
+  const double *restrict eu = c->u0, *restrict ev = c->v0, *restrict ep = c->p0;
+
+  change(c->u0, c->f.u, c->g.nx * sc);
+  change(c->v0, c->f.v, (c->g.nx + 1) * sc);
+  change(c->p0, c->f.p, (c->g.nx + 1) * sc);
+
+  /* A fine face either lies on a coarse one or halfway between two; a fine
+   * cell centre lies a quarter of the way from the centre of its coarse cell
+   * to that of a neighbour. The changes of the ghost points follow from the
+   * boundary conditions of both states. */
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = 1; i < g->nx - 1; i++) {
+    int ic = i / 2;
+
+    for (j = 1; j < g->ny; j++) {
+      int jc = (j + 1) / 2, jn = (j & 1) ? jc - 1 : jc + 1;
+      double e = lin(eu, CDX(ic, jc), CDX(ic, jn));
+
+      if (i & 1) {
+        e = 0.5 * (e + lin(eu, CDX(ic + 1, jc), CDX(ic + 1, jn)));
+      }
+      f->un[IDX(i, j)] = f->u[IDX(i, j)] + e;
+    }
+  }
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = 1; i < g->nx; i++) {
+    int ic = (i + 1) / 2, in = (i & 1) ? ic - 1 : ic + 1;
+
+    for (j = 1; j < g->ny - 1; j++) {
+      int jc = j / 2;
+      double e = lin(ev, CDX(ic, jc), CDX(in, jc));
+
+      if (j & 1) {
+        e = 0.5 * (e + lin(ev, CDX(ic, jc + 1), CDX(in, jc + 1)));
+      }
+      f->vn[IDX(i, j)] = f->v[IDX(i, j)] + e;
+    }
+  }
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = 1; i < g->nx; i++) {
+    int ic = (i + 1) / 2, in = (i & 1) ? ic - 1 : ic + 1;
+
+    for (j = 1; j < g->ny; j++) {
+      int jc = (j + 1) / 2, jn = (j & 1) ? jc - 1 : jc + 1;
+
+      f->pn[IDX(i, j)] = f->p[IDX(i, j)] +
+                         0.75 * lin(ep, CDX(ic, jc), CDX(ic, jn)) +
+                         0.25 * lin(ep, CDX(in, jc), CDX(in, jn));
+    }
+  }
+
+  set_UBC(f, g, s);
+  set_PBC(f, g, s);
+}
+
+/* Carry out a cycle on the level l from its state in u, v and p, and leave the
+ * new state in un, vn and pn */
+static void cycle(struct Multigrid *mg, int l, struct FieldPointers *f,
+                  struct Grid2D *g, struct SimulationInfo *s) {
+  int n;
+  struct MGLevel *lv = &mg->lv[l], *c = &mg->lv[l + 1];
+
+  /* The coarsest level is only smoothed */
+  if (l == mg->nlevels - 1) {
+    for (n = 1; n < s->mg_pre + s->mg_post; n++) {
+      step(lv, f, g, s);
+      update(f);
+    }
+    step(lv, f, g, s);
+    return;
+  }
+
+  for (n = 0; n < s->mg_pre; n++) {
+    step(lv, f, g, s);
+    update(f);
+  }
+
+  /* Residual of the smoothed state, which is also the one checked for
+   * convergence on the finest level */
+  step(lv, f, g, s);
+  if (l == 0) {
+    l2_norm(f, g, s);
+  }
+
+  restrict_level(f, g, s, c);
+  for (n = 0; n < s->mg_gamma; n++) {
+    cycle(mg, l + 1, &c->f, &c->g, &c->s);
+    update(&c->f);
+  }
+  correct(f, g, s, c);
+
+  for (n = 0; n < s->mg_post; n++) {
+    update(f);
+    step(lv, f, g, s);
+  }
+}
+
+/* Set up the coarser levels of the grid g */
+void mg_init(struct Multigrid *mg, struct Grid2D *g,
+             struct SimulationInfo *s) {
+  struct Grid2D *gf = g;
+  struct SimulationInfo *sf = s;
+
+  mg->lv[0].u0 = mg->lv[0].v0 = mg->lv[0].p0 = NULL;
+  mg->lv[0].su = mg->lv[0].sv = mg->lv[0].sp = NULL;
+  mg->nlevels = 1;
+
+  /* Coarsen while both directions have an even number of cells, and at least
+   * 4 of them */
+  while (mg->nlevels < s->mg_levels && mg->nlevels < MG_LEVELS &&
+         (gf->nx - 1) % 2 == 0 && (gf->ny - 1) % 2 == 0 && gf->nx > 4 &&
+         gf->ny > 4) {
+    struct MGLevel *c = &mg->lv[mg->nlevels];
+
+    /* The coarse levels keep the parameters of the flow and the cfl, and do
+     * not use residual smoothing */
+    c->s = *sf;
+    c->s.irs = 0.0;
+    c->g.nx = (gf->nx - 1) / 2 + 1;
+    c->g.ny = (gf->ny - 1) / 2 + 1;
+    initialize(&c->f, &c->g, &c->s);
+
+    /* Central differences are stable at the larger time step of a coarse
+     * level only with its cell Reynolds number at most 2. The coarse levels
+     * only correct the finer ones, so a larger viscosity leaves the solution
+     * as it is. */
+    c->s.nu = fmax(c->s.nu, 0.5 * fabs(s->ubc[0]) * fmin(c->g.dx, c->g.dy));
+    set_level_dt(&c->g, &c->s,
+                 sf->dt * fmin(c->g.dx, c->g.dy) / fmin(gf->dx, gf->dy));
+
+    c->u0 = field_2D(c->g.nx, c->g.stride);
+    c->v0 = field_2D(c->g.nx + 1, c->g.stride);
+    c->p0 = field_2D(c->g.nx + 1, c->g.stride);
+    c->su = field_2D(c->g.nx, c->g.stride);
+    c->sv = field_2D(c->g.nx + 1, c->g.stride);
+    c->sp = field_2D(c->g.nx + 1, c->g.stride);
+
+    gf = &c->g;
+    sf = &c->s;
+    mg->nlevels++;
+  }
+
+  if (mg->nlevels == 1 && s->mg_levels > 1) {
+    printf("Multigrid needs an even number of cells, nx - 1 and ny - 1, and "
+           "is off\n");
+  } else if (mg->nlevels < s->mg_levels) {
+    printf("Multigrid is limited to %d levels on this grid\n", mg->nlevels);
+  }
+}
+
+/* Carry out one multigrid cycle from the fields u, v and p */
+void mg_cycle(struct Multigrid *mg, struct FieldPointers *f, struct Grid2D *g,
+              struct SimulationInfo *s) {
+  TIMER_START(T_MULTIGRID);
+  cycle(mg, 0, f, g, s);
+  TIMER_STOP();
+}
+
+/* Free the coarser levels */
+void mg_free(struct Multigrid *mg) {
+  for (int l = 1; l < mg->nlevels; l++) {
+    struct MGLevel *c = &mg->lv[l];
+
+    free_fields(&c->g);
+    free(c->u0);
+    free(c->v0);
+    free(c->p0);
+    free(c->su);
+    free(c->sv);
+    free(c->sp);
+  }
+  mg->nlevels = 0;
+}
@@ -0,0 +1,103 @@
+#include "relaxation.h"
+
+/* Implicit residual smoothing acts on the change of a field over an
+ * iteration, dn = un - u, and replaces it by the solution of
+ * (1 - eps d_xx)(1 - eps d_yy) dn' = dn, which damps its high frequencies and
+ * allows a cfl about sqrt(1 + 4 eps) times larger. The steady state is the
+ * same, as dn vanishes there either way. */
+
+/* Number of columns smoothed together along x by a thread */
+#define IRS_COLS 64
+
+/* Solve (1 - eps d_xx)(1 - eps d_yy) x = d on [is, ie) x [js, je) in place,
+ * with x = 0 outside, by the Thomas algorithm along y and then along x */
+static void smooth(double *d, int is, int ie, int js, int je, int st,
+                   double eps) {
+  int i, j, k, b, n = (ie - is > je - js) ? ie - is : je - js;
+  double *cp = (double *)malloc(sizeof(double) * n);
+  double *m = (double *)malloc(sizeof(double) * n);
+
+  /* The coefficients are the same on all the lines: the inverse pivots m and
+   * the upper diagonal cp of the eliminated system */
+  m[0] = 1.0 / (1.0 + 2.0 * eps);
+  cp[0] = -eps * m[0];
+  for (k = 1; k < n; k++) {
+    m[k] = 1.0 / (1.0 + 2.0 * eps + eps * cp[k - 1]);
+    cp[k] = -eps * m[k];
+  }
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = is; i < ie; i++) {
+    double *r = d + IDX(i, js);
+
+    r[0] *= m[0];
+    for (j = 1; j < je - js; j++) {
+      r[j] = (r[j] + eps * r[j - 1]) * m[j];
+    }
+    for (j = je - js - 2; j >= 0; j--) {
+      r[j] -= cp[j] * r[j + 1];
+    }
+  }
+
+#pragma omp parallel for private(b, i, j) schedule(auto)
+  for (b = js; b < je; b += IRS_COLS) {
+    int jb = (b + IRS_COLS < je) ? b + IRS_COLS : je;
+
+    for (j = b; j < jb; j++) {
+      d[IDX(is, j)] *= m[0];
+    }
+    for (i = is + 1; i < ie; i++) {
+      for (j = b; j < jb; j++) {
+        d[IDX(i, j)] = (d[IDX(i, j)] + eps * d[IDX(i - 1, j)]) * m[i - is];
+      }
+    }
+    for (i = ie - 2; i >= is; i--) {
+      for (j = b; j < jb; j++) {
+        d[IDX(i, j)] -= cp[i - is] * d[IDX(i + 1, j)];
+      }
+    }
+  }
+
+  free(cp);
+  free(m);
+}
+
+/* Smooth the update of a field on [is, ie) x [js, je) */
+static void relax(double *restrict un, const double *restrict u,
+                  struct Grid2D *g, struct SimulationInfo *s, int is, int ie,
+                  int js, int je) {
+  int i, j, st = g->stride;
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = is; i < ie; i++) {
+    for (j = js; j < je; j++) {
+      un[IDX(i, j)] -= u[IDX(i, j)];
+    }
+  }
+
+  smooth(un, is, ie, js, je, st, s->irs);
+
+#pragma omp parallel for private(i, j) schedule(auto)
+  for (i = is; i < ie; i++) {
+    for (j = js; j < je; j++) {
+      un[IDX(i, j)] += u[IDX(i, j)];
+    }
+  }
+}
+
+/* Smooth the changes of u and v */
+void relax_U(struct FieldPointers *f, struct Grid2D *g,
+             struct SimulationInfo *s) {
+  TIMER_START(T_RELAX);
+  relax(f->un, f->u, g, s, 1, g->nx - 1, 1, g->ny);
+  relax(f->vn, f->v, g, s, 1, g->nx, 1, g->ny - 1);
+  TIMER_STOP();
+}
+
+/* Smooth the changes of p */
+void relax_P(struct FieldPointers *f, struct Grid2D *g,
+             struct SimulationInfo *s) {
+  TIMER_START(T_RELAX);
+  relax(f->pn, f->p, g, s, 1, g->nx, 1, g->ny);
+  TIMER_STOP();
+}
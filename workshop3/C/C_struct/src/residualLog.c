@@ -0,0 +1,55 @@
+#include "residualLog.h"
+
+/* Open the log file; append to it when resuming a run */
+void log_open(struct ResidualLog *log, int binary, int append) {
+  log->binary = binary;
+  log->count = 0;
+
+  if (binary) {
+    log->fd = fopen("data/residual.bin", append ? "a+b+e" : "w+b+e");
+  } else {
+    log->fd = fopen("data/residual", append ? "a+t+e" : "w+t+e");
+  }
+  if (!log->fd) {
+    printf("Cannot open the residual log in data/\n");
+    exit(EXIT_FAILURE);
+  }
+  if (!binary && !append) {
+    fprintf(log->fd, "# iteration\ttotal\tu\tv\tp\tdivergence\n");
+  }
+}
+
+/* Add the residuals of an iteration to the log */
+void log_residuals(struct ResidualLog *log, int itr, double *errs) {
+  double *r = log->records[log->count];
+
+  r[0] = (double)itr;
+  for (int k = 0; k < 5; k++) {
+    r[k + 1] = errs[k];
+  }
+  if (++log->count == LOG_RECORDS) {
+    log_flush(log);
+  }
+}
+
+/* Write out the buffered records */
+void log_flush(struct ResidualLog *log) {
+  if (log->binary) {
+    fwrite(log->records, sizeof(log->records[0]), log->count, log->fd);
+  } else {
+    for (int n = 0; n < log->count; n++) {
+      double *r = log->records[n];
+
+      fprintf(log->fd, "%d\t%.8lf\t%.8lf\t%.8lf\t%.8lf\t%.8lf\n", (int)r[0],
+              r[1], r[2], r[3], r[4], r[5]);
+    }
+  }
+  fflush(log->fd);
+  log->count = 0;
+}
+
+/* Write out the buffered records and close the log file */
+void log_close(struct ResidualLog *log) {
+  log_flush(log);
+  fclose(log->fd);
+}
@@ -0,0 +1,151 @@
+#include "timers.h"
+
+#ifdef TIMERS
+#ifdef PAPI
+#include <papi.h>
+#endif
+
+/* Deepest nesting of the phases */
+#define T_DEPTH 8
+
+static const char *phase_names[T_PHASES] = {
+    "momentum", "continuity", "relaxation", "boundary",
+    "residual", "multigrid",  "fused",      "inplace",  "output"};
+
+#ifdef PAPI
+/* Hardware counters read for each phase; the ones the CPU lacks are
+ * skipped */
+#define T_EVENTS 3
+static int event_codes[T_EVENTS] = {PAPI_TOT_CYC, PAPI_TOT_INS, PAPI_L3_TCM};
+static const char *event_names[T_EVENTS] = {"cycles", "instructions",
+                                            "L3 misses"};
+#endif
+
+/* Accumulated time and entries of each phase and the phases being in, the
+ * last one entered on top */
+static struct {
+  double start;
+  double last;
+  double time[T_PHASES];
+  long calls[T_PHASES];
+  int stack[T_DEPTH];
+  int depth;
+#ifdef PAPI
+  int set;
+  int nevents;
+  int event[T_EVENTS];
+  long long last_count[T_EVENTS];
+  long long count[T_PHASES][T_EVENTS];
+#endif
+} t;
+
+/* Wall-clock time in seconds */
+static double wtime(void) {
+  struct timespec ts;
+
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* Charge the phase being in with the time, and counts, since the last
+ * change of phase */
+static void charge(void) {
+  double now = wtime();
+
+  if (t.depth > 0) {
+    t.time[t.stack[t.depth - 1]] += now - t.last;
+  }
+  t.last = now;
+
+#ifdef PAPI
+  long long c[T_EVENTS];
+
+  if (t.nevents > 0 && PAPI_read(t.set, c) == PAPI_OK) {
+    for (int e = 0; e < t.nevents; e++) {
+      if (t.depth > 0) {
+        t.count[t.stack[t.depth - 1]][e] += c[e] - t.last_count[e];
+      }
+      t.last_count[e] = c[e];
+    }
+  }
+#endif
+}
+
+/* Start the clock of the whole run, and the hardware counters with PAPI */
+void timer_init(void) {
+  t.start = t.last = wtime();
+
+#ifdef PAPI
+  /* The counters follow the main thread only */
+  t.set = PAPI_NULL;
+  if (PAPI_library_init(PAPI_VER_CURRENT) != PAPI_VER_CURRENT ||
+      PAPI_create_eventset(&t.set) != PAPI_OK) {
+    printf("PAPI is not available, no hardware counters are read\n");
+    return;
+  }
+  for (int e = 0; e < T_EVENTS; e++) {
+    if (PAPI_add_event(t.set, event_codes[e]) == PAPI_OK) {
+      t.event[t.nevents++] = e;
+    }
+  }
+  if (t.nevents > 0 && PAPI_start(t.set) == PAPI_OK) {
+    PAPI_read(t.set, t.last_count);
+  } else {
+    t.nevents = 0;
+  }
+#endif
+}
+
+/* Enter a phase */
+void timer_start(enum Phase k) {
+  charge();
+  if (t.depth < T_DEPTH) {
+    t.stack[t.depth++] = k;
+  }
+  t.calls[k]++;
+}
+
+/* Leave the phase entered last */
+void timer_stop(void) {
+  charge();
+  if (t.depth > 0) {
+    t.depth--;
+  }
+}
+
+/* Print the time per phase */
+void timer_report(void) {
+  double total = wtime() - t.start, other = total;
+  int k;
+
+  printf("\n%-12s %11s %7s %11s\n", "phase", "time (s)", "share", "calls");
+  for (k = 0; k < T_PHASES; k++) {
+    other -= t.time[k];
+    if (t.calls[k] > 0) {
+      printf("%-12s %11.4e %6.1f%% %11ld\n", phase_names[k], t.time[k],
+             100.0 * t.time[k] / total, t.calls[k]);
+    }
+  }
+  printf("%-12s %11.4e %6.1f%%\n", "other", other, 100.0 * other / total);
+  printf("%-12s %11.4e\n", "total", total);
+
+#ifdef PAPI
+  if (t.nevents > 0) {
+    printf("\n%-12s", "phase");
+    for (int e = 0; e < t.nevents; e++) {
+      printf(" %13s", event_names[t.event[e]]);
+    }
+    printf("\n");
+    for (k = 0; k < T_PHASES; k++) {
+      if (t.calls[k] > 0) {
+        printf("%-12s", phase_names[k]);
+        for (int e = 0; e < t.nevents; e++) {
+          printf(" %13lld", t.count[k][e]);
+        }
+        printf("\n");
+      }
+    }
+  }
+#endif
+}
+#endif /* TIMERS */
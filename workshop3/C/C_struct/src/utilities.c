@@ -29,9 +29,43 @@ double **array_2D(int row, int col) {
   return arr;
 }
 
+/* Find the row stride of a field with col columns; rows are padded so that
+ * each one starts on a cache line */
+int field_stride(int col) {
+  return STRIDE(col);
+}
+
+/* Generate a zeroed 2D field stored row by row in one aligned block */
+double *field_2D(int row, int stride) {
+  double *arr = (double *)aligned_alloc(ALIGN, sizeof(double) * row * stride);
+
+  if (!arr) {
+    printf("Memory allocation error.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (int i = 0; i < row * stride; i++) {
+    arr[i] = 0.0;
+  }
+  return arr;
+}
+
+/* Free the buffers of all the fields */
+void free_fields(struct Grid2D *g) {
+  free(g->ubufo);
+  free(g->ubufn);
+  free(g->vbufo);
+  free(g->vbufn);
+  free(g->pbufo);
+  free(g->pbufn);
+  free(g->rows);
+  g->ubufo = g->ubufn = g->vbufo = g->vbufn = g->pbufo = g->pbufn = NULL;
+  g->rows = NULL;
+}
+
 /* Update the fields to the new time step for the next iteration */
 void update(struct FieldPointers *f) {
-  double **tmp;
+  double *tmp;
 
   tmp = f->u;
   f->u = f->un;
@@ -75,14 +109,14 @@ double fmaxof(int count, ...) {
 }
 
 /* Find mamximum of an array */
-double fmaxarr(double **arr, int xmax, int ymax) {
-  double max = arr[0][0];
+double fmaxarr(double *arr, int xmax, int ymax, int st) {
+  double max = arr[0];
   int i, j;
 
 #pragma omp parallel for private(i, j) schedule(auto) reduction(max: max)
   for (i = 0; i < xmax; i++) {
     for (j = 0; j < ymax; j++) {
-      max = fmax(max, arr[i][j]);
+      max = fmax(max, arr[IDX(i, j)]);
     }
   }
 
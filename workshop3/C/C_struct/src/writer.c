@@ -2,7 +2,7 @@
 
 /* Save fields data to files */
 void dump_data(struct Grid2D *g, struct FieldPointers *f) {
-  int i, j, count;
+  int i, j, count, st = g->stride;
   FILE *fd;
 
   /* Arrays for storing fields at grid points */
@@ -15,15 +15,14 @@ void dump_data(struct Grid2D *g, struct FieldPointers *f) {
   #pragma omp parallel for private(i, j) schedule(auto)
   for (i = 0; i < g->nx; i++) {
     for (j = 0; j < g->ny; j++) {
-      ug[i][j] = 0.5 * (f->u[i][j + 1] + f->u[i][j]);
-      vg[i][j] = 0.5 * (f->v[i + 1][j] + f->v[i][j]);
-      pg[i][j] = 0.25 * (f->p[i][j] + f->p[i + 1][j] + f->p[i][j + 1] +
-                         f->p[i + 1][j + 1]);
+      ug[i][j] = 0.5 * (f->u[IDX(i, j + 1)] + f->u[IDX(i, j)]);
+      vg[i][j] = 0.5 * (f->v[IDX(i + 1, j)] + f->v[IDX(i, j)]);
+      pg[i][j] = 0.25 * (f->p[IDX(i, j)] + f->p[IDX(i + 1, j)] +
+                         f->p[IDX(i, j + 1)] + f->p[IDX(i + 1, j + 1)]);
     }
   }
 
-  count = 6;
-  freeMem(count, g->ubufo, g->vbufo, g->pbufo, g->ubufn, g->vbufn, g->pbufn);
+  free_fields(g);
 
   /* Writing the field data from MASTER */
   fd = fopen("data/xyuvp", "w+t+e");
@@ -0,0 +1,313 @@
+"""Benchmark the lid-driven cavity solvers on equal terms.
+
+Every solver runs the same cavity at Re = 100 for a fixed number of iterations
+over a matrix of grid sizes x MPI ranks x OpenMP threads; C_parallel3D runs
+the cubic cavity on n x n x n grids. For each case the
+time per iteration, MLUPS (million grid points updated per second), the
+achieved memory bandwidth and its fraction of the STREAM triad bandwidth are
+reported, along with the strong and weak scaling efficiencies, in JSON.
+
+Usage: python3 bench.py [OPTION]...
+e.g.   python3 bench.py --solvers C_struct,C_parallel --grids 128,256,512 \\
+                        --ranks 1,2,4 --threads 1,2 --output bench.json
+
+The C solvers are used as built in their bin/ directories, with --build
+building them first with OpenMP. The time per iteration of the solvers
+taking --itr-max is the difference of a run of 2n and one of n iterations
+divided by n, so the start-up and the output cancel out, n being doubled
+until the run of 2n is the slower one; C_original and C_expanded have a
+fixed 128 x 128 grid and no iteration limit, so they are timed over a whole
+run to convergence instead. acmFoam needs a sourced
+OpenFOAM environment. The cases that fail are listed with their errors under
+"failed" in the JSON, and the exit status is then 1.
+"""
+import argparse
+import json
+import os
+import platform
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+here = os.path.dirname(os.path.abspath(__file__))
+root = os.path.dirname(here)
+
+# Bytes moved per grid point and iteration by the C kernels, counted as
+# STREAM does, i.e. without write-allocate: momentum reads u, v, p and writes
+# un, vn, continuity reads un, vn, p and writes pn and the residuals read all
+# six fields; 15 doubles in all. In 3D w adds a field to each: 20 doubles.
+BYTES_PER_LUP = 15 * 8
+BYTES_PER_LUP_3D = 20 * 8
+
+# Solvers, their directories and how their iterations are controlled
+SOLVERS = {
+    "C_original": ("C/C_original", "fixed"),
+    "C_expanded": ("C/C_expanded", "fixed"),
+    "C_struct": ("C/C_struct", "itr"),
+    "C_parallel": ("C/C_parallel", "itr"),
+    "C_parallel3D": ("C/C_parallel3D", "itr"),
+    "numba": ("python/numba/src", "itr"),
+    "acmFoam": ("OpenFOAM/cavity", "itr"),
+}
+
+# Runs the numba time loop for n iterations after compiling it, or loading it
+# from the cache, reporting the elapsed time of the iterations only
+NUMBA_LOOP = """
+import sys, time
+import numpy as np
+import functions as fn
+nx, n = int(sys.argv[1]), int(sys.argv[2])
+g = fn.Grid2D(nx, nx, 1.0)
+s = fn.Simulation(g, cfl=0.15, c2=5.0, Re=100.0, tol=0.0)
+s.advance(1)
+t = time.perf_counter()
+s.advance(n)
+print(time.perf_counter() - t)
+"""
+
+
+def run(cmd, cwd, env=None):
+    """Run a command, returning its wall-clock time and output"""
+    t = time.perf_counter()
+    res = subprocess.run(cmd, cwd=cwd, env=env, stdout=subprocess.PIPE,
+                         stderr=subprocess.STDOUT, universal_newlines=True)
+    t = time.perf_counter() - t
+    if "iverged" in res.stdout or (res.returncode != 0 and
+                                   "exceeded" not in res.stdout):
+        raise RuntimeError("%s failed:\n%s" % (" ".join(cmd), res.stdout))
+    return t, res.stdout
+
+
+def best_of(args, f):
+    """Best of args.repeat runs of f, which returns a time and a result"""
+    return min((f() for _ in range(args.repeat)), key=lambda r: r[0])
+
+
+def per_iteration(args, span, tries=5):
+    """Time per iteration from the runs span(n) and span(2n) of n and 2n
+    iterations, and n. Below the noise of the start-up the run of 2n may be
+    no slower than that of n, so n is doubled until it is, up to tries
+    times."""
+    n = args.iterations
+    for _ in range(tries):
+        t1 = best_of(args, lambda: span(n))[0]
+        t2 = best_of(args, lambda: span(2 * n))[0]
+        if t2 > t1:
+            return (t2 - t1) / n, n
+        n *= 2
+    raise RuntimeError("%d iterations take no longer than %d" % (n, n // 2))
+
+
+def time_c(args, name, nx, ranks, threads, work):
+    """Time per iteration of a C solver, and its iterations"""
+    exe = os.path.join(root, SOLVERS[name][0], "bin", "lidCavity")
+    if not os.path.exists(exe):
+        raise RuntimeError("%s is not built, see --build" % exe)
+    env = dict(os.environ, OMP_NUM_THREADS=str(threads),
+               OMP_PLACES="cores", OMP_PROC_BIND="close")
+    os.makedirs(os.path.join(work, "data"), exist_ok=True)
+    launch = args.launcher.split() + ["-np", str(ranks)] \
+        if name in ("C_parallel", "C_parallel3D") else []
+    nz = ["--nz", str(nx)] if name == "C_parallel3D" else []
+
+    if SOLVERS[name][1] == "fixed":
+        t, out = best_of(args, lambda: run(launch + [exe, "100"], work, env))
+        itr = int(re.search(r"after (\d+) iterations", out).group(1))
+        return t / itr, itr
+
+    def span(n):
+        return run(launch + [exe, "100", "--nx", str(nx), "--ny", str(nx)] +
+                   nz + ["--itr-max", str(n), "--tol", "1e-300",
+                             "--log-itr", str(n)], work, env)
+
+    return per_iteration(args, span)
+
+
+def time_numba(args, nx, threads, work):
+    """Time per iteration of the numba solver"""
+    env = dict(os.environ, NUMBA_NUM_THREADS=str(threads),
+               PYTHONPATH=os.path.join(root, SOLVERS["numba"][0]))
+    n = args.iterations
+    t = best_of(args, lambda: (float(run([sys.executable, "-c", NUMBA_LOOP,
+                                          str(nx), str(n)], work, env)[1]),
+                               None))[0]
+    return t / n, n
+
+
+def time_foam(args, nx, ranks, threads, work):
+    """Time per iteration of acmFoam, from its own execution time"""
+    case = os.path.join(work, "cavity")
+    shutil.rmtree(case, ignore_errors=True)
+    shutil.copytree(os.path.join(root, SOLVERS["acmFoam"][0]), case)
+    param = os.path.join(case, "constant", "parameters")
+    dt = float(subprocess.check_output(
+        ["foamDictionary", "-entry", "dt", "-value", param]))
+
+    def setting(entry, value, path=param):
+        subprocess.check_call(["foamDictionary", "-entry", entry, "-set",
+                               str(value), path], stdout=subprocess.DEVNULL)
+
+    def span(n):
+        setting("simTime", n * dt)
+        launch = ["acmFoam"]
+        if ranks > 1:
+            launch = args.launcher.split() + ["-np", str(ranks), "acmFoam",
+                                              "-parallel"]
+            run(["decomposePar", "-force"], case)
+        out = run(launch, case)[1]
+        return float(re.findall(r"ExecutionTime = ([0-9.e+-]+)", out)[-1]), n
+
+    setting("size", nx)
+    setting("tol", 1e-300)
+    setting("numberOfSubdomains", ranks,
+            os.path.join(case, "system", "decomposeParDict"))
+    run(["blockMesh"], case)
+    return per_iteration(args, span)
+
+
+def stream(args, work):
+    """STREAM triad bandwidth in GB/s with all the threads of the node"""
+    if args.stream is not None:
+        return args.stream
+    exe = os.path.join(work, "stream")
+    subprocess.check_call([args.cc, "-O3", "-fopenmp", "-march=native",
+                           os.path.join(here, "stream.c"), "-o", exe])
+    return float(subprocess.check_output([exe]))
+
+
+def build(name):
+    """Configure and build a C solver with OpenMP into its bin/ directory"""
+    src = os.path.join(root, SOLVERS[name][0])
+    subprocess.check_call(["cmake", "-S", src, "-B",
+                           os.path.join(src, "build"), "-DUSE_OpenMP=ON",
+                           "-DCMAKE_BUILD_TYPE=Release"])
+    subprocess.check_call(["cmake", "--build", os.path.join(src, "build")])
+
+
+def scaling(results):
+    """Add the strong and weak scaling efficiencies with respect to the run
+    of each solver with the fewest cores: the same grid for the strong one,
+    and the same number of points per core for the weak one"""
+    for r in results:
+        same = [b for b in results if b["solver"] == r["solver"]]
+        fewest = min(b["cores"] for b in same)
+        base = [b for b in same if b["cores"] == fewest]
+
+        strong = [b for b in base if b["grid"] == r["grid"]]
+        r["strong_efficiency"] = strong[0]["time_per_iteration"] * fewest / \
+            (r["time_per_iteration"] * r["cores"]) if strong else None
+
+        dim = 3 if r["solver"] == "C_parallel3D" else 2
+        weak = [b for b in base if b["grid"] ** dim * r["cores"] ==
+                r["grid"] ** dim * fewest]
+        r["weak_efficiency"] = weak[0]["time_per_iteration"] / \
+            r["time_per_iteration"] if weak else None
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Benchmark the lid-driven cavity solvers")
+    parser.add_argument("--solvers", default="C_struct,C_parallel",
+                        help="comma-separated among " + ", ".join(SOLVERS))
+    parser.add_argument("--grids", default="128,256",
+                        help="comma-separated grid sizes n of n x n grids")
+    parser.add_argument("--ranks", default="1",
+                        help="comma-separated numbers of MPI ranks")
+    parser.add_argument("--threads", default="1",
+                        help="comma-separated numbers of threads per rank")
+    parser.add_argument("--iterations", type=int, default=1000,
+                        help="iterations n, timed as 2n minus n")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="runs per case, the fastest one is kept")
+    parser.add_argument("--launcher", default="mpirun --bind-to core",
+                        help="MPI launcher, -np is appended")
+    parser.add_argument("--stream", type=float,
+                        help="STREAM bandwidth in GB/s instead of measuring")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"),
+                        help="C compiler for the STREAM triad")
+    parser.add_argument("--build", action="store_true",
+                        help="build the C solvers with OpenMP first")
+    parser.add_argument("--output", default="bench.json",
+                        help="JSON file for the results")
+    args = parser.parse_args()
+
+    solvers = args.solvers.split(",")
+    for name in solvers:
+        if name not in SOLVERS:
+            parser.error("unknown solver %s" % name)
+        if args.build and name.startswith("C_"):
+            build(name)
+
+    work = tempfile.mkdtemp(prefix="bench")
+    results = []
+    failed = []
+    bw_stream = stream(args, work)
+    print("STREAM triad: %.1f GB/s" % bw_stream)
+    print("%-11s %6s %5s %7s %11s %8s %7s %6s" %
+          ("solver", "grid", "ranks", "threads", "s/iteration", "MLUPS",
+           "GB/s", "STREAM"))
+
+    for name in solvers:
+        fixed = SOLVERS[name][1] == "fixed"
+        for nx in [int(n) for n in args.grids.split(",")]:
+            for ranks in [int(n) for n in args.ranks.split(",")]:
+                for threads in [int(n) for n in args.threads.split(",")]:
+                    # Only the MPI solvers run on several ranks, and the
+                    # fixed solvers on their own grid only
+                    if (ranks > 1 and name not in
+                            ("C_parallel", "C_parallel3D", "acmFoam")) \
+                            or (fixed and nx != 128):
+                        continue
+                    case = {"solver": name, "grid": nx, "ranks": ranks,
+                            "threads": threads, "cores": ranks * threads}
+                    # A failing case is recorded and the others go on
+                    try:
+                        if name == "numba":
+                            t, itr = time_numba(args, nx, threads, work)
+                        elif name == "acmFoam":
+                            t, itr = time_foam(args, nx, ranks, threads, work)
+                        else:
+                            t, itr = time_c(args, name, nx, ranks, threads,
+                                            work)
+                    except Exception as e:
+                        failed.append(dict(case, error=str(e)))
+                        print("%-11s %6d %5d %7d failed: %s" %
+                              (name, nx, ranks, threads,
+                               str(e).splitlines()[0] if str(e) else
+                               type(e).__name__))
+                        continue
+
+                    dim = 3 if name == "C_parallel3D" else 2
+                    mlups = nx ** dim / t * 1e-6
+                    # The finite volume solver moves an unknown amount of data
+                    bw = mlups * (BYTES_PER_LUP_3D if dim == 3 else
+                                  BYTES_PER_LUP) * 1e-3 \
+                        if name != "acmFoam" else None
+                    results.append(dict(
+                        case, iterations=itr, time_per_iteration=t,
+                        mlups=mlups, bandwidth=bw,
+                        stream_fraction=bw / bw_stream if bw else None))
+                    print("%-11s %6d %5d %7d %11.3e %8.1f %7s %6s" %
+                          (name, nx, ranks, threads, t, mlups,
+                           "%.1f" % bw if bw else "-",
+                           "%.0f%%" % (100 * bw / bw_stream) if bw else "-"))
+
+    scaling(results)
+    shutil.rmtree(work, ignore_errors=True)
+    with open(args.output, "w") as fd:
+        json.dump({"host": platform.node(), "cpu": platform.processor(),
+                   "date": time.strftime("%Y-%m-%dT%H:%M:%S"),
+                   "stream_bandwidth": bw_stream,
+                   "bytes_per_lup": BYTES_PER_LUP,
+                   "bytes_per_lup_3d": BYTES_PER_LUP_3D,
+                   "iterations": args.iterations, "repeat": args.repeat,
+                   "results": results, "failed": failed}, fd, indent=2)
+    print("Results written to %s" % args.output)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
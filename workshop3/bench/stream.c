@@ -0,0 +1,57 @@
+/* STREAM triad, a[i] = b[i] + s * c[i], for the reference memory bandwidth of
+ * bench.py. Prints the best of ntimes runs in GB/s, counting 24 bytes per
+ * element as STREAM does.
+ *
+ * Usage: stream [n [ntimes]], with n elements per array (default 2^25) */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now(void) {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+  long i, n = argc > 1 ? atol(argv[1]) : 1L << 25;
+  int k, ntimes = argc > 2 ? atoi(argv[2]) : 10;
+  double *a = malloc(sizeof(double) * n), *b = malloc(sizeof(double) * n),
+         *c = malloc(sizeof(double) * n), best = 1e30, s = 3.0;
+
+  if (!a || !b || !c) {
+    printf("Memory allocation error.\n");
+    return EXIT_FAILURE;
+  }
+
+  /* First touch by the threads that run the triad */
+#pragma omp parallel for schedule(static)
+  for (i = 0; i < n; i++) {
+    a[i] = 0.0;
+    b[i] = 1.0;
+    c[i] = 2.0;
+  }
+
+  for (k = 0; k < ntimes; k++) {
+    double t = now();
+
+#pragma omp parallel for schedule(static)
+    for (i = 0; i < n; i++) {
+      a[i] = b[i] + s * c[i];
+    }
+    t = now() - t;
+    best = t < best ? t : best;
+  }
+
+  /* Checking the result also keeps the triad from being optimized away */
+  if (a[n - 1] != 7.0) {
+    printf("Wrong triad result.\n");
+    return EXIT_FAILURE;
+  }
+  printf("%.3f\n", 24.0 * n / best * 1e-9);
+  free(a);
+  free(b);
+  free(c);
+  return EXIT_SUCCESS;
+}
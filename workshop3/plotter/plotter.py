@@ -4,6 +4,8 @@ import matplotlib.pyplot as plt
 from matplotlib import cm
 from mpl_toolkits.axes_grid1 import make_axes_locatable
 from sys import argv
+import json
+import os
 
 
 re = argv[1]
@@ -98,15 +100,25 @@ plt.clf()
 
 # =========================================================================== #
 # Plot residuals
-data = np.loadtxt("data/residual", dtype=np.float)
+# The logs of C_parallel3D have a column for w too
+names = ["tot", "u", "v", "p", "div"]
+if os.path.isfile("data/uvp.json"):
+    with open("data/uvp.json") as fd:
+        if "w" in json.load(fd)["fields"]:
+            names = ["tot", "u", "v", "w", "p", "div"]
+
+# Binary logs hold the iteration and the residuals of each record, in the
+# columns of the text log
+if os.path.isfile("data/residual.bin"):
+    data = np.fromfile("data/residual.bin",
+                       dtype=np.float64).reshape(-1, len(names) + 1)
+else:
+    data = np.loadtxt("data/residual", dtype=np.float)
 c = 10
 
 fig, ax = newfig(0.8)
-ax.semilogy(data[c:, 0], data[c:, 1], label="tot", linewidth=0.6)
-ax.semilogy(data[c:, 0], data[c:, 2], label="u", linewidth=0.6)
-ax.semilogy(data[c:, 0], data[c:, 3], label="v", linewidth=0.6)
-ax.semilogy(data[c:, 0], data[c:, 4], label="p", linewidth=0.6)
-ax.semilogy(data[c:, 0], data[c:, 5], label="div", linewidth=0.6)
+for k, name in enumerate(names):
+    ax.semilogy(data[c:, 0], data[c:, k + 1], label=name, linewidth=0.6)
 
 ax.tick_params(direction='out', top=False, right=False)
 ax.set_title("Residual")
@@ -0,0 +1,52 @@
+"""Convert the binary fields file of C_parallel to the text format read by
+plotter.py. The fields of C_parallel3D are written on the mid-plane z = 0.5,
+interpolated between the two planes next to it on even grids.
+
+Usage: python3 uvp2txt.py [descriptor] [output]
+defaults: data/uvp.json data/xyuvp
+"""
+import json
+import os
+import sys
+from array import array
+
+desc = sys.argv[1] if len(sys.argv) > 1 else "data/uvp.json"
+out = sys.argv[2] if len(sys.argv) > 2 else "data/xyuvp"
+
+# =========================================================================== #
+with open(desc) as fd:
+    meta = json.load(fd)
+
+nx, ny = meta["shape"][:2]
+dx, dy = meta["spacing"][:2]
+nz = meta["shape"][2] if len(meta["shape"]) > 2 else 1
+n = nx * ny * nz
+
+# Fields u, v (w) and p of nx x ny (x nz) points each, one after another
+data = array('d')
+with open(os.path.join(os.path.dirname(desc), meta["file"]), "rb") as fd:
+    data.fromfile(fd, len(meta["fields"]) * n)
+if meta["byte_order"] != sys.byteorder:
+    data.byteswap()
+
+# Planes of the mid-plane and their weights; a single one for 2D fields
+k0 = (nz - 1) // 2
+k1 = nz // 2
+a = 0.5 if k1 > k0 else 1.0
+uvp = array('d')
+for name in ["u", "v", "p"]:
+    f = meta["fields"].index(name) * n
+    for i in range(nx):
+        for j in range(ny):
+            k = (i * ny + j) * nz
+            uvp.append(a * data[f + k + k0] + (1.0 - a) * data[f + k + k1])
+n = nx * ny
+
+with open(out, "w") as fd:
+    fd.write("# X \t Y \t U \t V \t P\n")
+    for i in range(nx):
+        for j in range(ny):
+            k = i * ny + j
+            fd.write("%.8f \t %.8f \t %.8f \t %.8f \t %.8f\n" %
+                     (float(i) * dx, float(j) * dy, uvp[k], uvp[n + k],
+                      uvp[2 * n + k]))
@@ -1,6 +1,13 @@
 import numpy as np
 from numba import njit, stencil, prange
 
+# Fast-math flags of the compiled kernels: all of them but nnan and ninf, so a
+# diverging run is still caught by its residuals
+FASTMATH = {'reassoc', 'contract', 'arcp', 'nsz', 'afn'}
+
+# States of a run, as returned by Simulation.advance
+RUNNING, CONVERGED, DIVERGED, EXCEEDED = range(4)
+
 
 class Grid2D(object):
     """ Generates a mesh assuming equal spacing in x and y direction.
@@ -26,7 +33,7 @@ class Grid2D(object):
         self.xtot = ngx + 1
         self.ytot = ngy + 1
 
-        self.dx = l_lid / np.float(ngx - 1)
+        self.dx = l_lid / float(ngx - 1)
         self.dy = self.dx
 
         # Variables on staggered grid points
@@ -48,35 +55,21 @@ class Grid2D(object):
                    'v': {'t': 0.0, 'b': 0.0, 'r': 0.0, 'l': 0.0},
                    'p': {'t': 0.0, 'b': 0.0, 'r': 0.0, 'l': 0.0}}
 
+    # Values of the boundary conditions for the compiled kernels: bc[f, s]
+    # of the field f = u, v, p on the side s = t, b, r, l
+    def bc_array(self):
+        return np.array([[self.BC[f][s] for s in 'tbrl'] for f in 'uvp'])
+
     # Dirichlet BC for velocity field
     def BC_u(self):
-        self.u[self.xlo:self.xhi, 0] = \
-            self.BC['u']['b'] - self.u[self.xlo:self.xhi, 1]
-        self.u[self.xlo:self.xhi, self.ytot - 1] = \
-            2.0 * self.BC['u']['t'] - self.u[self.xlo:self.xhi, self.ytot - 2]
-        self.u[0, :self.ytot] = self.BC['u']['l']
-        self.u[self.xhi, :self.ytot] = self.BC['u']['r']
+        bc_u(self.u, self.bc_array())
 
     def BC_v(self):
-        self.v[self.xlo:self.xtot - 1, 0] = self.BC['v']['b']
-        self.v[self.xlo:self.xtot - 1, self.yhi] = self.BC['v']['t']
-        self.v[0, :self.ngy] = \
-            self.BC['v']['l'] - self.v[1, :self.ngy]
-        self.v[self.xtot - 1, :self.ngy] = \
-            self.BC['v']['r'] - self.v[self.xtot - 2, :self.ngy]
+        bc_v(self.v, self.bc_array())
 
     # Neumann BC for pressure field
     def BC_p(self):
-        self.p[self.xlo:self.xtot - 1, 0] = \
-            self.p[self.xlo:self.xtot - 1, 1] - self.dy * self.BC['p']['b']
-        self.p[self.xlo:self.xtot - 1, self.ytot - 1] = \
-            self.p[self.xlo:self.xtot - 1, self.ytot - 2] - \
-            self.dy * self.BC['p']['t']
-        self.p[0, :self.ytot] = \
-            self.p[1, :self.ytot] - self.dx * self.BC['p']['l']
-        self.p[self.xtot - 1, :self.ytot] = \
-            self.p[self.xtot - 2, :self.ytot] - \
-            self.dx * self.BC['p']['r']
+        bc_p(self.p, self.bc_array(), self.dx, self.dy)
 
 
 class Simulation(object):
@@ -105,10 +98,18 @@ class Simulation(object):
 
         self.dtxy = self.dt * grid.dx * grid.dy
 
+        # Number of the next iteration, and the second buffers of the fields
+        # the compiled time loop alternates with those of the grid
+        self.itr = 1
+        self.bc = grid.bc_array()
+
         self.init_cond()
         grid.BC_u()
         grid.BC_v()
         grid.BC_p()
+        self.un = grid.u.copy()
+        self.vn = grid.v.copy()
+        self.pn = grid.p.copy()
 
     # Impose initial condition
     def init_cond(self):
@@ -116,9 +117,18 @@ class Simulation(object):
         g.u[g.xlo:g.xhi, g.ytot - 1] = g.BC['u']['t']
         g.u[g.xlo:g.xhi, g.ytot - 2] = g.BC['u']['t']
 
-    # Compute L2-norm based on new and pold time steps data
-    def l2norm(self, phi_n, phi_o):
-        return np.sqrt(self.dtxy * np.sum((phi_n - phi_o)**2))
+    # Carry out up to n iterations in compiled code, stopping once the run is
+    # no longer RUNNING. Returns the residuals of the iterations, rows of
+    # itr, total, u, v, p and div[v] errors, and the state of the run.
+    def advance(self, n):
+        g = self.grid
+        res = np.empty((n, 6), dtype=np.float64)
+        g.u, g.v, g.p, self.un, self.vn, self.pn, k, state = solve(
+            g.u, g.v, g.p, self.un, self.vn, self.pn, self.bc, self.dt,
+            g.dx, g.dy, self.nu, self.c2, self.tol, self.itr,
+            int(self.itr_max), res)
+        self.itr += k
+        return res[:k], state
 
 
 # Compute average in x-direction
@@ -139,57 +149,151 @@ def ave_xy(arr):
     return 0.25 * (arr[0, 0] + arr[0, -1] + arr[-1, 0] + arr[-1, -1])
 
 
-# Solve momentum equation in x and y direction
-@njit(parallel=True)
-def momentum(uo, vo, po, dt, dx, dy, nu):
-    un = uo.copy()
-    vn = vo.copy()
-
+# Dirichlet BC for velocity field; bc as given by Grid2D.bc_array
+@njit(fastmath=FASTMATH, cache=True)
+def bc_u(u, bc):
+    nx, ny = u.shape
+    for i in range(1, nx - 1):
+        u[i, 0] = bc[0, 1] - u[i, 1]
+        u[i, ny - 1] = 2.0 * bc[0, 0] - u[i, ny - 2]
+    for j in range(ny):
+        u[0, j] = bc[0, 3]
+        u[nx - 1, j] = bc[0, 2]
+
+
+@njit(fastmath=FASTMATH, cache=True)
+def bc_v(v, bc):
+    nx, ny = v.shape
+    for i in range(1, nx - 1):
+        v[i, 0] = bc[1, 1]
+        v[i, ny - 1] = bc[1, 0]
+    for j in range(ny):
+        v[0, j] = bc[1, 3] - v[1, j]
+        v[nx - 1, j] = bc[1, 2] - v[nx - 2, j]
+
+
+# Neumann BC for pressure field
+@njit(fastmath=FASTMATH, cache=True)
+def bc_p(p, bc, dx, dy):
+    nx, ny = p.shape
+    for i in range(1, nx - 1):
+        p[i, 0] = p[i, 1] - dy * bc[2, 1]
+        p[i, ny - 1] = p[i, ny - 2] - dy * bc[2, 0]
+    for j in range(ny):
+        p[0, j] = p[1, j] - dx * bc[2, 3]
+        p[nx - 1, j] = p[nx - 2, j] - dx * bc[2, 2]
+
+
+# Time loop: carry out iterations itr, itr + 1, ... from the fields u, v and p,
+# alternating with the buffers un, vn and pn, until the residual drops below
+# tol, the fields diverge, itr_max is exceeded or res, the residuals of the
+# iterations, is full. Each iteration solves the momentum equations, a row of
+# u and the row of v on the same i at a time, then the continuity equation,
+# summing up their residuals on the way, and applies the BCs in between.
+# Returns the latest and the spare fields, the number of iterations carried
+# out and the state of the run.
+@njit(parallel=True, fastmath=FASTMATH, cache=True)
+def solve(u, v, p, un, vn, pn, bc, dt, dx, dy, nu, c2, tol, itr, itr_max,
+          res):
     dtdx = dt / dx
     dtdy = dt / dy
     dtdxx = dt / (dx * dx)
     dtdyy = dt / (dy * dy)
-
-    ug = ave_y(uo)
-    uc = ave_x(uo)
-    vg = ave_x(vo)
-    vc = ave_y(vo)
-
-    for i in prange(1, uo.shape[0] - 1):
-        for j in prange(1, uo.shape[1] - 1):
-            un[i, j] = uo[i, j] \
-                - dtdx * (uc[i+1, j] * uc[i+1, j] - uc[i, j] * uc[i, j]) \
-                - dtdy * (ug[i, j+1] * vg[i+1, j] - ug[i, j] * vg[i+1, j-1]) \
-                - dtdx * (po[i+1, j] - po[i, j]) \
-                + nu * (dtdxx * (uo[i-1, j] - 2 * uo[i, j] + uo[i+1, j])
-                        + dtdyy * (uo[i, j-1] - 2 * uo[i, j] + uo[i, j+1]))
-
-    for i in prange(1, vo.shape[0] - 1):
-        for j in prange(1, vo.shape[1] - 1):
-            vn[i, j] = vo[i, j] \
-                - dtdx * (ug[i, j+1] * vg[i+1, j] - ug[i-1, j+1] * vg[i, j]) \
-                - dtdy * (vc[i, j+1] * vc[i, j+1] - vc[i, j] * vc[i, j]) \
-                - dtdy * (po[i, j+1] - po[i, j]) \
-                + nu * (dtdxx * (vo[i-1, j] - 2 * vo[i, j] + vo[i+1, j])
-                        + dtdyy * (vo[i, j-1] - 2 * vo[i, j] + vo[i, j+1]))
-    return un, vn
-
-
-# Solve continuity equation
-@njit(parallel=True)
-def continuity(uo, vo, po, dt, dx, dy, c2):
-    dtdx = dt / dx
-    dtdy = dt / dy
-
-    cn_err = np.zeros_like(po)
-    pn = po.copy()
-
-    err = 0.0
-    for i in prange(1, vo.shape[0] - 1):
-        for j in prange(1, uo.shape[1] - 1):
-            cn_err[i, j] = dtdx * (uo[i, j] - uo[i-1, j]) \
-                + dtdy * (vo[i, j] - vo[i, j-1])
-            pn[i, j] = po[i, j] - c2 * cn_err[i, j]
-            err += cn_err[i, j]
-
-    return pn, err
+    dtxy = dt * dx * dy
+
+    nxu, nyu = u.shape
+    nxv, nyv = v.shape
+    nxp, nyp = p.shape
+
+    state = RUNNING
+    k = 0
+    while k < res.shape[0]:
+        u_err = 0.0
+        v_err = 0.0
+        for i in prange(1, nxv - 1):
+            eu = 0.0
+            if i < nxu - 1:
+                for j in range(1, nyu - 1):
+                    un[i, j] = u[i, j] \
+                        - 0.25 * dtdx * ((u[i+1, j] + u[i, j])**2
+                                         - (u[i, j] + u[i-1, j])**2) \
+                        - 0.25 * dtdy * ((u[i, j+1] + u[i, j])
+                                         * (v[i+1, j] + v[i, j])
+                                         - (u[i, j] + u[i, j-1])
+                                         * (v[i+1, j-1] + v[i, j-1])) \
+                        - dtdx * (p[i+1, j] - p[i, j]) \
+                        + nu * (dtdxx * (u[i-1, j] - 2 * u[i, j] + u[i+1, j])
+                                + dtdyy * (u[i, j-1] - 2 * u[i, j]
+                                           + u[i, j+1]))
+                    eu += (un[i, j] - u[i, j])**2
+
+            ev = 0.0
+            for j in range(1, nyv - 1):
+                vn[i, j] = v[i, j] \
+                    - 0.25 * dtdx * ((u[i, j+1] + u[i, j])
+                                     * (v[i+1, j] + v[i, j])
+                                     - (u[i-1, j+1] + u[i-1, j])
+                                     * (v[i, j] + v[i-1, j])) \
+                    - 0.25 * dtdy * ((v[i, j+1] + v[i, j])**2
+                                     - (v[i, j] + v[i, j-1])**2) \
+                    - dtdy * (p[i, j+1] - p[i, j]) \
+                    + nu * (dtdxx * (v[i-1, j] - 2 * v[i, j] + v[i+1, j])
+                            + dtdyy * (v[i, j-1] - 2 * v[i, j] + v[i, j+1]))
+                ev += (vn[i, j] - v[i, j])**2
+
+            u_err += eu
+            v_err += ev
+
+        # Check if the results diverged (NAN or INF); the fields are left as
+        # they were before the iteration
+        if not np.isfinite(u_err + v_err):
+            state = DIVERGED
+            break
+
+        bc_u(un, bc)
+        bc_v(vn, bc)
+
+        # Compute pressure using continuity equation, as well as continuity
+        # error (div[v])
+        p_err = 0.0
+        c_err = 0.0
+        for i in prange(1, nxp - 1):
+            ep = 0.0
+            ec = 0.0
+            for j in range(1, nyp - 1):
+                div = dtdx * (un[i, j] - un[i-1, j]) \
+                    + dtdy * (vn[i, j] - vn[i, j-1])
+                pn[i, j] = p[i, j] - c2 * div
+                ep += div * div
+                ec += div
+            p_err += ep
+            c_err += ec
+
+        bc_p(pn, bc, dx, dy)
+
+        u_err = np.sqrt(dtxy * u_err)
+        v_err = np.sqrt(dtxy * v_err)
+        p_err = c2 * np.sqrt(dtxy * p_err)
+        err = max(u_err, v_err, p_err, c_err)
+        res[k, 0] = itr
+        res[k, 1] = err
+        res[k, 2] = u_err
+        res[k, 3] = v_err
+        res[k, 4] = p_err
+        res[k, 5] = c_err
+        k += 1
+
+        u, un = un, u
+        v, vn = vn, v
+        p, pn = pn, p
+
+        # Check if convergence achieved
+        if err < tol:
+            state = CONVERGED
+            break
+        if itr > itr_max:
+            state = EXCEEDED
+            break
+        itr += 1
+
+    return u, v, p, un, vn, pn, k, state
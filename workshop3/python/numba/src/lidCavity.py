@@ -44,50 +44,21 @@ else:
 
 flog = open('data/residual', 'ab')
 
-itr = 1
-while True:
-    # Compute velocity field using momentum equations
-    u_n, v_n = fn.momentum(g.u, g.v, g.p, s.dt, g.dx, g.dy, s.nu)
-
-    # Check if the results diverged (NAN or INF)
-    if np.isnan(np.sum(u_n)) or np.isinf(np.sum(u_n)):
-        print("Diverged after {:d} iterations.".format(itr))
-        flog.close()
-        exit(1)
-
-    # Compute L2-norm error based on the new and old time steps
-    u_err = s.l2norm(u_n, g.u)
-    v_err = s.l2norm(v_n, g.v)
-
-    # Update velocity field and apply Dirichlet boundary condition
-    g.u = u_n
-    g.v = v_n
-    g.BC_u()
-    g.BC_v()
-
-    # Compute pressure using continuity equation and update velocity field,
-    # as well as continuity error (div[v]).
-    p_n, c_err = fn.continuity(g.u, g.v, g.p, s.dt, g.dx, g.dy, s.c2)
-    p_err = s.l2norm(p_n, g.p)
-    err = np.max([u_err, v_err, p_err, c_err])
-
-    # Write obtained errors
-    np.savetxt(flog, np.c_[itr, err, u_err, v_err, p_err, c_err], fmt='%.8f')
-
-    # Update pressure field and apply Neumman boundary condition
-    g.p = p_n
-    g.BC_p()
-
-    # Check if convergence achieved
-    if err < s.tol or itr > s.itr_max:
-        print("Converged after {:d} iterations".format(itr))
-        flog.close()
-        break
-    itr += 1
-
-if itr > s.itr_max:
-    print("Maximum number of iterations, {:d}, exceeded".format(itr))
+# Run the time loop in compiled code, writing the residuals of each batch
+# of iterations: itr, total, u, v, p and div[v] errors
+state = fn.RUNNING
+while state == fn.RUNNING:
+    res, state = s.advance(1000)
+    np.savetxt(flog, res, fmt='%.8f')
+flog.close()
+
+if state == fn.DIVERGED:
+    print("Diverged after {:d} iterations.".format(s.itr))
+    exit(1)
+if state == fn.EXCEEDED:
+    print("Maximum number of iterations, {:d}, exceeded".format(s.itr - 1))
     exit(2)
+print("Converged after {:d} iterations".format(s.itr - 1))
 
 # Compute velocity and pressure fields on grid points for visualization
 v_x = fn.ave_y(g.u)[:, 1:]
@@ -100,11 +71,11 @@ xpos, ypos = np.meshgrid(xp, yp)
 
 # Compute v at the middle of domain along x-axis
 v_mid = 0.5 * np.sum(v_y[:,
-                         np.int(v_x.shape[1] / 2) - 1:
-                         np.int(v_x.shape[1] / 2) + 1], axis=1)
+                         int(v_x.shape[1] / 2) - 1:
+                         int(v_x.shape[1] / 2) + 1], axis=1)
 # Compute u at the middle of domain along y-axis
-u_mid = 0.5 * np.sum(v_x[np.int(v_y.shape[0] / 2) - 1:
-                         np.int(v_y.shape[0] / 2) + 1, :], axis=0)
+u_mid = 0.5 * np.sum(v_x[int(v_y.shape[0] / 2) - 1:
+                         int(v_y.shape[0] / 2) + 1, :], axis=0)
 
 # Write the field data visulization
 np.savetxt('data/Central_U', np.c_[u_mid, yp], fmt='%.8f')